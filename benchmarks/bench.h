@@ -0,0 +1,39 @@
+#ifndef STRTB_BENCHMARKS_BENCH_H
+#define STRTB_BENCHMARKS_BENCH_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace strtb::benchmarks {
+
+typedef std::chrono::steady_clock bench_clock;
+
+inline double elapsed_ms(bench_clock::time_point start, bench_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Each run is repeated this many times, and the best time is reported
+const int repeats = 7;
+
+// A named document to run a benchmark on
+struct document {
+    std::string name;
+    std::string text;
+};
+
+// Documents given on the command line, or generated ones if there are none
+std::vector<document> load_documents(int argc, char **argv, std::vector<document> (*generate)());
+
+// Generated documents, made the same way every time so results can be compared between builds
+std::string generate_chat_document(size_t messages);
+std::string generate_number_document(size_t rows);
+std::string generate_string_document(size_t strings);
+
+// Benchmarks, one per file
+int json_arena(int argc, char **argv);
+int json_numbers(int argc, char **argv);
+
+}
+
+#endif // STRTB_BENCHMARKS_BENCH_H
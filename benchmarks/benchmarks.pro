@@ -0,0 +1,17 @@
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = strtb-bench
+LIBS += -L../libstrtb -lstrtb
+
+include( ../version.pri )
+
+SOURCES += \
+    json_arena.cpp \
+    json_numbers.cpp \
+    main.cpp \
+
+HEADERS += \
+    bench.h \
@@ -0,0 +1,45 @@
+#include "bench.h"
+#include "../src/json/parser.h"
+#include "../src/json/arena.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace strtb;
+using namespace strtb::benchmarks;
+
+static std::vector<document> generate() {
+    return {
+        {"chat (100k messages)", generate_chat_document(100000)},
+        {"numbers (300k rows)", generate_number_document(300000)},
+        {"strings (100k)", generate_string_document(100000)},
+    };
+}
+
+// Parse-and-drop of whole documents, with values on the heap and in an arena
+int benchmarks::json_arena(int argc, char **argv) {
+    for (const auto &doc : load_documents(argc, argv, generate)) {
+        double heap_parse = 1e9, heap_drop = 1e9, arena_parse = 1e9, arena_drop = 1e9;
+        for (int i=0; i<repeats; i++) {
+            auto start = bench_clock::now();
+            json::value *val = json::parser::from_string(doc.text);
+            auto parsed = bench_clock::now();
+            delete val;
+            auto dropped = bench_clock::now();
+            heap_parse = std::min(heap_parse, elapsed_ms(start, parsed));
+            heap_drop = std::min(heap_drop, elapsed_ms(parsed, dropped));
+
+            start = bench_clock::now();
+            json::arena *arena = new json::arena();
+            json::parser::from_string(doc.text, arena);
+            parsed = bench_clock::now();
+            delete arena;
+            dropped = bench_clock::now();
+            arena_parse = std::min(arena_parse, elapsed_ms(start, parsed));
+            arena_drop = std::min(arena_drop, elapsed_ms(parsed, dropped));
+        }
+        printf("%s, %.1f MB: heap parse %.1f + drop %.1f ms, arena parse %.1f + drop %.1f ms\n",
+               doc.name.c_str(), doc.text.size() / 1e6, heap_parse, heap_drop, arena_parse, arena_drop);
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include "bench.h"
+#include "../src/json/parser.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace strtb;
+using namespace strtb::benchmarks;
+
+static std::vector<document> generate() {
+    return {{"numbers (1M rows)", generate_number_document(1000000)}};
+}
+
+// Parsing and writing of number-heavy documents, checking that numbers survive the round trip
+int benchmarks::json_numbers(int argc, char **argv) {
+    int result = 0;
+    for (const auto &doc : load_documents(argc, argv, generate)) {
+        double parse = 1e9, write = 1e9;
+        json::value *val = nullptr;
+        std::string written;
+        for (int i=0; i<repeats; i++) {
+            delete val;
+            auto start = bench_clock::now();
+            val = json::parser::from_string(doc.text);
+            auto parsed = bench_clock::now();
+            written = val->write_to_string();
+            auto done = bench_clock::now();
+            parse = std::min(parse, elapsed_ms(start, parsed));
+            write = std::min(write, elapsed_ms(parsed, done));
+        }
+        json::value *again = json::parser::from_string(written);
+        bool exact = again->write_to_string() == written;
+        printf("%s, %.1f MB: parse %.1f ms, write %.1f ms, round trip %s\n",
+               doc.name.c_str(), doc.text.size() / 1e6, parse, write, exact ? "exact" : "NOT EXACT");
+        if (!exact)
+            result = 1;
+        delete again;
+        delete val;
+    }
+    return result;
+}
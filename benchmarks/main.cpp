@@ -0,0 +1,116 @@
+#include "bench.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace strtb;
+using namespace strtb::benchmarks;
+
+std::vector<document> benchmarks::load_documents(int argc, char **argv, std::vector<document> (*generate)()) {
+    if (argc == 0)
+        return generate();
+    std::vector<document> docs;
+    for (int i=0; i<argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file)
+            throw std::runtime_error(std::string("Couldn't open ") + argv[i]);
+        std::stringstream contents;
+        contents << file.rdbuf();
+        docs.push_back({argv[i], contents.str()});
+    }
+    return docs;
+}
+
+// Small xorshift generator, so documents don't depend on the standard library's random engines
+static uint64_t next_random(uint64_t &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+std::string benchmarks::generate_chat_document(size_t messages) {
+    static const char *words[] = {"hello", "world", "PogChamp", "\\\"quoted\\\"", "\\u00e9", "line\\nbreak", "message", "chat"};
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    std::string out = "{\n  \"messages\": [";
+    for (size_t i=0; i<messages; i++) {
+        out += i ? ",\n    {" : "\n    {";
+        out += "\n      \"id\": \"" + std::to_string(i) + "\",";
+        out += "\n      \"user\": {\"id\": \"" + std::to_string(next_random(state) % 1000000) + "\", \"name\": \"user"
+             + std::to_string(i % 5000) + "\", \"color\": \"#ff00aa\", \"badges\": [\"mod\", \"sub\"]},";
+        out += "\n      \"message\": \"";
+        size_t word_count = 4 + next_random(state) % 12;
+        for (size_t w=0; w<word_count; w++) {
+            if (w)
+                out += ' ';
+            out += words[next_random(state) % (sizeof(words) / sizeof(words[0]))];
+        }
+        out += "\",";
+        out += "\n      \"timestamp\": " + std::to_string(1700000000000ULL + i * 250) + ",";
+        out += "\n      \"score\": " + std::to_string((next_random(state) % 1000000) / 1000.0) + ",";
+        out += std::string("\n      \"flags\": {\"mod\": ") + (i % 7 ? "false" : "true") + ", \"deleted\": null}";
+        out += "\n    }";
+    }
+    out += "\n  ]\n}\n";
+    return out;
+}
+
+std::string benchmarks::generate_number_document(size_t rows) {
+    // Rows of a float with a long fraction, a big integer and a small signed fraction
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    std::string out = "[";
+    char buffer[96];
+    for (size_t i=0; i<rows; i++) {
+        double f = (double) (next_random(state) % 1000000000000ULL) / 1000000.0;
+        long long n = (long long) (next_random(state) % 2000000000000ULL) - 1000000000000LL;
+        double g = (double) (next_random(state) % 2000000000ULL) / 1000000000.0 - 1.0;
+        snprintf(buffer, sizeof(buffer), "%s[%.17g, %lld, %.17g]", i ? ", " : "", f, n, g);
+        out += buffer;
+    }
+    out += "]";
+    return out;
+}
+
+std::string benchmarks::generate_string_document(size_t strings) {
+    static const char *words[] = {"chat", "hello", "world", "tab\\t", "\\\"quoted\\\"", "\\u65e5\\u672c", "message", "line\\nbreak"};
+    uint64_t state = 0xd1b54a32d192ed03ULL;
+    std::string out = "[";
+    for (size_t i=0; i<strings; i++) {
+        out += i ? ", \"" : "\"";
+        size_t word_count = 8 + next_random(state) % 40;
+        for (size_t w=0; w<word_count; w++) {
+            if (w)
+                out += ' ';
+            out += words[next_random(state) % (sizeof(words) / sizeof(words[0]))];
+        }
+        out += '"';
+    }
+    out += "]";
+    return out;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s <arena|numbers> [file.json...]\n", name);
+    fprintf(stderr, "Runs on generated documents if no files are given.\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 2;
+    }
+    try {
+        if (strcmp(argv[1], "arena") == 0)
+            return benchmarks::json_arena(argc - 2, argv + 2);
+        if (strcmp(argv[1], "numbers") == 0)
+            return benchmarks::json_numbers(argc - 2, argv + 2);
+    } catch (std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    usage(argv[0]);
+    return 2;
+}
@@ -18,7 +18,14 @@ SOURCES += \
     ../src/common/version.cpp \
     ../src/config/system.cpp \
     ../src/config/id_type.cpp \
+    ../src/json/arena.cpp \
+    ../src/json/compact.cpp \
+    ../src/json/incremental.cpp \
+    ../src/json/lazy.cpp \
     ../src/json/parser.cpp \
+    ../src/json/parser_core.cpp \
+    ../src/json/reader.cpp \
+    ../src/json/structural_index.cpp \
     ../src/json/value.cpp \
     ../src/json/value_array.cpp \
     ../src/json/value_bool.cpp \
@@ -28,28 +35,57 @@ SOURCES += \
     ../src/json/value_object.cpp \
     ../src/json/value_string.cpp \
     ../src/json/value_utils.cpp \
+    ../src/json/writer.cpp \
     ../src/logging/logging.cpp \
+    ../src/chat/analytics.cpp \
+    ../src/chat/batch_writer.cpp \
     ../src/chat/channel.cpp \
+    ../src/chat/flood_detector.cpp \
     ../src/chat/provider.cpp \
     ../src/chat/queue.cpp \
+    ../src/chat/scheduling.cpp \
+    ../src/chat/search_index.cpp \
+    ../src/chat/snapshot.cpp \
+    ../src/chat/sse_server.cpp \
     ../src/chat/subscription.cpp \
     ../src/chat/system.cpp \
+    ../src/chat/timestamp_merger.cpp \
+    ../src/chat/tokenizer.cpp \
+    ../src/chat/topology.cpp \
     ../src/unicode/unicode.cpp
 
 HEADERS += \
+    ../src/chat/analytics.h \
+    ../src/chat/batch_writer.h \
     ../src/chat/channel.h \
+    ../src/chat/flood_detector.h \
     ../src/chat/message.h \
+    ../src/chat/middleware.h \
     ../src/chat/provider.h \
     ../src/chat/queue.h \
+    ../src/chat/scheduling.h \
+    ../src/chat/search_index.h \
+    ../src/chat/snapshot.h \
+    ../src/chat/sse_server.h \
     ../src/chat/subscription.h \
     ../src/chat/system.h \
+    ../src/chat/timestamp_merger.h \
+    ../src/chat/tokenizer.h \
+    ../src/chat/topology.h \
     ../src/common/deregistration_interface.h \
     ../src/common/strescape.h \
     ../src/common/version.h \
     ../src/config/id_type.h \
     ../src/config/system.h \
     ../src/json/all_value_types.h \
+    ../src/json/arena.h \
+    ../src/json/compact.h \
+    ../src/json/incremental.h \
+    ../src/json/lazy.h \
     ../src/json/parser.h \
+    ../src/json/parser_core.h \
+    ../src/json/reader.h \
+    ../src/json/structural_index.h \
     ../src/json/value.h \
     ../src/json/value_array.h \
     ../src/json/value_bool.h \
@@ -59,6 +95,7 @@ HEADERS += \
     ../src/json/value_object.h \
     ../src/json/value_string.h \
     ../src/json/value_utils.h \
+    ../src/json/writer.h \
     ../src/logging/logging.h \
     ../src/plugins/link.h \
     ../src/unicode/unicode.h
@@ -0,0 +1,173 @@
+#include "analytics.h"
+#include "tokenizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+using namespace strtb;
+using namespace strtb::chat;
+
+static int64_t current_second() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+analytics::~analytics() {
+    for (auto &item : this->channels)
+        delete item.second;
+}
+
+uint64_t analytics::hash(const std::string &str) {
+    // FNV-1a, followed by a splitmix64 finalizer so all bits are usable for the sketches
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : str) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+void analytics::count_min_top_k::add(const std::string &key, uint64_t hash) {
+    // Conservative update: only raise the counters that hold the current minimum
+    uint32_t h1 = hash, h2 = (hash >> 32) | 1;
+    uint32_t *cells[cms_depth];
+    uint32_t estimate = UINT32_MAX;
+    for (int i=0; i<cms_depth; i++) {
+        cells[i] = &this->counters[i][(h1 + i * h2) % cms_width];
+        estimate = std::min(estimate, *cells[i]);
+    }
+    if (estimate == UINT32_MAX)
+        return;
+    for (auto cell : cells)
+        if (*cell == estimate)
+            (*cell)++;
+    estimate++;
+
+    // Keep the top-K list up to date
+    auto lowest = this->top.end();
+    for (auto itr = this->top.begin(); itr != this->top.end(); itr++) {
+        if (itr->key == key) {
+            itr->count = estimate;
+            return;
+        }
+        if (lowest == this->top.end() || itr->count < lowest->count)
+            lowest = itr;
+    }
+    if (this->top.size() < top_k)
+        this->top.push_back({key, estimate});
+    else if (lowest->count < estimate)
+        *lowest = {key, estimate};
+}
+
+std::vector<ranked_item> analytics::count_min_top_k::get_top() const {
+    std::vector<ranked_item> sorted = this->top;
+    std::sort(sorted.begin(), sorted.end(), [](const ranked_item &a, const ranked_item &b) {return a.count > b.count;});
+    return sorted;
+}
+
+void analytics::advance_window(channel_state &state, int64_t second) {
+    // Clear the buckets of the seconds that passed since the last message
+    int64_t passed = second - state.window_last_second;
+    if (passed <= 0)
+        return;
+    for (int64_t s = std::max(state.window_last_second + 1, second - window_seconds + 1); s <= second; s++)
+        state.window[s % window_seconds] = 0;
+    state.window_last_second = second;
+}
+
+uint64_t analytics::estimate_unique(const channel_state &state) {
+    // HyperLogLog estimate, with linear counting for small cardinalities
+    const double m = state.hll.size();
+    double estimate = (0.7213 / (1 + 1.079 / m)) * m * m / state.hll_sum;
+    if (estimate <= 2.5 * m && state.hll_zeros > 0)
+        estimate = m * std::log(m / state.hll_zeros);
+    return std::llround(estimate);
+}
+
+void analytics::process(const std::vector<message> &messages) {
+    int64_t second = current_second();
+    std::lock_guard<std::mutex> guard(this->lock);
+    channel_state *state = nullptr;
+    const message *prev = nullptr;
+
+    for (auto &msg : messages) {
+        // Batches usually come from the same channel, so avoid looking it up again
+        if (!prev || prev->provider_id != msg.provider_id || prev->channel_id != msg.channel_id) {
+            auto itr = this->channels.emplace(std::make_pair(msg.provider_id, msg.channel_id), nullptr);
+            if (itr.second)
+                itr.first->second = new channel_state;
+            state = itr.first->second;
+        }
+        prev = &msg;
+
+        // Message rate
+        advance_window(*state, second);
+        state->window[second % window_seconds]++;
+        state->total_messages++;
+
+        // Unique and most active chatters
+        const std::string &user_key = msg.user_id.empty() ? msg.user_name : msg.user_id;
+        uint64_t user_hash = hash(user_key);
+        size_t reg = user_hash >> (64 - hll_precision);
+        uint8_t rank = __builtin_clzll((user_hash << hll_precision) | (1ULL << (hll_precision - 1))) + 1;
+        if (state->hll[reg] < rank) {
+            if (state->hll[reg] == 0)
+                state->hll_zeros--;
+            state->hll_sum += std::ldexp(1.0, -rank) - std::ldexp(1.0, -state->hll[reg]);
+            state->hll[reg] = rank;
+        }
+        state->chatters.add(msg.user_name.empty() ? msg.user_id : msg.user_name, user_hash);
+
+        // Most used words and emotes
+        for (auto &word : split_words(msg.message, max_words_per_message))
+            state->words.add(word, hash(word));
+    }
+}
+
+channel_analytics analytics::get_locked(const std::pair<std::string, std::string> &id, channel_state &state, int64_t second) {
+    advance_window(state, second);
+    uint32_t per_minute = 0;
+    for (uint32_t count : state.window)
+        per_minute += count;
+    channel_analytics result;
+    result.provider_id = id.first;
+    result.channel_id = id.second;
+    result.total_messages = state.total_messages;
+    result.messages_per_minute = per_minute;
+    result.unique_chatters = estimate_unique(state);
+    result.top_words = state.words.get_top();
+    result.top_chatters = state.chatters.get_top();
+    return result;
+}
+
+channel_analytics analytics::get(const std::string &provider_id, const std::string &channel_id) {
+    int64_t second = current_second();
+    std::lock_guard<std::mutex> guard(this->lock);
+    auto id = std::make_pair(provider_id, channel_id);
+    auto itr = this->channels.find(id);
+    if (itr == this->channels.end())
+        return {provider_id, channel_id, 0, 0, 0, {}, {}};
+    return get_locked(id, *itr->second, second);
+}
+
+std::vector<channel_analytics> analytics::get_all() {
+    int64_t second = current_second();
+    std::lock_guard<std::mutex> guard(this->lock);
+    std::vector<channel_analytics> all;
+    all.reserve(this->channels.size());
+    for (auto &item : this->channels)
+        all.push_back(get_locked(item.first, *item.second, second));
+    return all;
+}
+
+void analytics::reset() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    for (auto &item : this->channels)
+        delete item.second;
+    this->channels.clear();
+}
@@ -0,0 +1,78 @@
+#ifndef STRTB_CHAT_ANALYTICS_H
+#define STRTB_CHAT_ANALYTICS_H
+
+#include "message.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include <mutex>
+#include <cstdint>
+
+namespace strtb::chat {
+
+struct ranked_item {
+    std::string key;
+    uint32_t count;
+};
+
+struct channel_analytics {
+    std::string provider_id, channel_id;
+    uint64_t total_messages;
+    uint32_t messages_per_minute;
+    uint64_t unique_chatters;   // Estimate
+    std::vector<ranked_item> top_words, top_chatters;   // Counts are estimates, sorted from highest
+};
+
+/* Live per-channel chat statistics in fixed memory per channel:
+ * - a one-minute sliding window of per-second message counts
+ * - a HyperLogLog sketch for the amount of unique chatters
+ * - count-min sketches with top-K lists for the most used words/emotes and the most active chatters
+ */
+class analytics {
+public:
+    static constexpr int window_seconds = 60;
+    static constexpr int hll_precision = 12;
+    static constexpr int cms_width = 2048;
+    static constexpr int cms_depth = 4;
+    static constexpr size_t top_k = 16;
+    static constexpr size_t max_words_per_message = 32;
+private:
+    class count_min_top_k {
+    private:
+        std::array<std::array<uint32_t, cms_width>, cms_depth> counters = {};
+        std::vector<ranked_item> top;
+    public:
+        void add(const std::string &key, uint64_t hash);
+        std::vector<ranked_item> get_top() const;
+    };
+    struct channel_state {
+        uint64_t total_messages = 0;
+        std::array<uint32_t, window_seconds> window = {};
+        int64_t window_last_second = 0;
+        std::array<uint8_t, 1 << hll_precision> hll = {};
+        // Kept up to date on register changes, so estimating is O(1)
+        double hll_sum = 1 << hll_precision;
+        int hll_zeros = 1 << hll_precision;
+        count_min_top_k words, chatters;
+    };
+
+    std::mutex lock;
+    std::map<std::pair<std::string, std::string>, channel_state*> channels;
+
+    static uint64_t hash(const std::string &str);
+    static void advance_window(channel_state &state, int64_t second);
+    static uint64_t estimate_unique(const channel_state &state);
+    static channel_analytics get_locked(const std::pair<std::string, std::string> &id, channel_state &state, int64_t second);
+public:
+    analytics() = default;
+    ~analytics();
+    void process(const std::vector<message> &messages);
+    channel_analytics get(const std::string &provider_id, const std::string &channel_id);
+    std::vector<channel_analytics> get_all();
+    void reset();
+};
+
+}
+
+#endif // STRTB_CHAT_ANALYTICS_H
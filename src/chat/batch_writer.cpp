@@ -0,0 +1,41 @@
+#include "batch_writer.h"
+#include "channel.h"
+
+using namespace strtb;
+using namespace strtb::chat;
+
+batch_writer::batch_writer(channel *target, size_t max_messages, std::chrono::microseconds max_delay)
+    : target(target), max_messages(max_messages ? max_messages : 1), max_delay(max_delay) {
+    this->buffer.reserve(this->max_messages);
+}
+
+batch_writer::~batch_writer() {
+    // Don't lose anything that's still buffered
+    this->flush();
+}
+
+void batch_writer::push(const message &message) {
+    this->push(chat::message(message));
+}
+
+void batch_writer::push(message &&message) {
+    auto now = std::chrono::steady_clock::now();
+    if (this->buffer.empty())
+        this->oldest = now;
+    this->buffer.push_back(std::move(message));
+    // Send the batch if it's full or has waited long enough
+    if (this->buffer.size() >= this->max_messages || now - this->oldest >= this->max_delay)
+        this->flush();
+}
+
+void batch_writer::flush() {
+    if (this->buffer.empty())
+        return;
+    this->target->push(std::move(this->buffer));
+    this->buffer.clear();
+    this->buffer.reserve(this->max_messages);
+}
+
+size_t batch_writer::pending() {
+    return this->buffer.size();
+}
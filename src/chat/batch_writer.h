@@ -0,0 +1,38 @@
+#ifndef STRTB_CHAT_BATCH_WRITER_H
+#define STRTB_CHAT_BATCH_WRITER_H
+
+#include "message.h"
+#include <vector>
+#include <chrono>
+
+namespace strtb::chat {
+
+class channel;
+
+/* Buffers messages of one producer thread and sends them to their channel in batches,
+ * so bursts cost one lock round-trip and one wake-up instead of one per message.
+ * A batch is sent once it has max_messages messages, or when a message is pushed after the oldest
+ * buffered one has waited for max_delay. There's no timer, so flush() must be called when a burst is over
+ * (e.g. after parsing a websocket frame).
+ * Not thread-safe: each producer thread should get its own writer, and writers must not outlive their channel.
+ */
+class batch_writer {
+private:
+    channel *target;
+    size_t max_messages;
+    std::chrono::microseconds max_delay;
+    std::vector<message> buffer;
+    std::chrono::steady_clock::time_point oldest;
+public:
+    batch_writer(channel *target, size_t max_messages, std::chrono::microseconds max_delay);
+    batch_writer(const batch_writer &from) = delete;
+    ~batch_writer();
+    void push(const message &message);
+    void push(message &&message);
+    void flush();
+    size_t pending();
+};
+
+}
+
+#endif // STRTB_CHAT_BATCH_WRITER_H
@@ -45,6 +45,22 @@ void channel::push(message &message) {
     }
 }
 
+void channel::push(message &&message) {
+    // Add channel and provider info to message
+    message.channel_id = this->channel_id;
+    message.channel_name = this->channel_name;
+    message.provider_id = this->provider_id;
+    message.provider_name = this->provider_name;
+    // Move message into queue
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (this->queue)
+            this->queue->push(std::move(message));
+        else
+            this->log.put(logging::ERROR, {"Can't push new message when abandoned by parent"});
+    }
+}
+
 void channel::push(std::vector<message> &messages) {
     // Add channel and provider info to messages
     for (auto &msg : messages) {
@@ -63,6 +79,28 @@ void channel::push(std::vector<message> &messages) {
     }
 }
 
+void channel::push(std::vector<message> &&messages) {
+    // Add channel and provider info to messages
+    for (auto &msg : messages) {
+        msg.channel_id = this->channel_id;
+        msg.channel_name = this->channel_name;
+        msg.provider_id = this->provider_id;
+        msg.provider_name = this->provider_name;
+    }
+    // Move messages into queue, unless abandoned
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (this->queue)
+            this->queue->push(std::move(messages));
+        else
+            this->log.put(logging::ERROR, {"Can't push new messages when abandoned by parent"});
+    }
+}
+
+std::unique_ptr<batch_writer> channel::batch_writer(size_t max_messages, std::chrono::microseconds max_delay) {
+    return std::make_unique<class batch_writer>(this, max_messages, max_delay);
+}
+
 void channel::abandon() {
     this->log.put(logging::WARNING, {"Abandoned by parent"});
     std::lock_guard<std::mutex> guard(this->lock);
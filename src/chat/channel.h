@@ -2,10 +2,13 @@
 #define STRTB_CHAT_CHANNEL_H
 
 #include "queue.h"
+#include "batch_writer.h"
 #include "../common/deregistration_interface.h"
 #include "../logging/logging.h"
 #include <vector>
 #include <mutex>
+#include <chrono>
+#include <memory>
 
 namespace strtb::chat {
 
@@ -34,7 +37,13 @@ public:
     std::string get_provider_name();
     channel_info get_info();
     void push(message &message);
+    void push(message &&message);
     void push(std::vector<message> &messages);
+    void push(std::vector<message> &&messages);
+    // Writer that sends this channel's messages in batches. max_delay is only checked when a message is pushed: nothing
+    // sends a batch in the background, so the caller must call flush() at the end of each burst, or the last messages
+    // stay buffered until the next push (or until the writer is destroyed)
+    std::unique_ptr<class batch_writer> batch_writer(size_t max_messages = 64, std::chrono::microseconds max_delay = std::chrono::microseconds(2000));
 };
 
 }
@@ -0,0 +1,140 @@
+#include "flood_detector.h"
+
+#include <algorithm>
+
+using namespace strtb;
+using namespace strtb::chat;
+
+static uint64_t mix(uint64_t h) {
+    // splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+flood_detector::flood_detector(const flood_detector_config &config) : config(config) {}
+
+uint64_t flood_detector::simhash(const std::string &text) {
+    // Normalize case and whitespace, so trivial variations still look alike
+    std::string normalized;
+    normalized.reserve(std::min(text.size(), max_shingles + 2));
+    for (unsigned char c : text) {
+        if (normalized.size() >= max_shingles + 2)
+            break;
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            if (!normalized.empty() && normalized.back() != ' ')
+                normalized.push_back(' ');
+        } else if ('A' <= c && c <= 'Z') {
+            normalized.push_back(c - 'A' + 'a');
+        } else {
+            normalized.push_back(c);
+        }
+    }
+    if (normalized.size() < 3)
+        return mix(std::hash<std::string>()(normalized));
+
+    // Each 3-byte shingle votes on every bit of the fingerprint
+    int votes[64] = {};
+    for (size_t i=0; i+3 <= normalized.size(); i++) {
+        uint64_t h = mix((uint64_t) (unsigned char) normalized[i] | ((uint64_t) (unsigned char) normalized[i+1] << 8)
+                         | ((uint64_t) (unsigned char) normalized[i+2] << 16));
+        for (int bit=0; bit<64; bit++)
+            votes[bit] += (h >> bit) & 1 ? 1 : -1;
+    }
+    uint64_t fingerprint = 0;
+    for (int bit=0; bit<64; bit++)
+        if (votes[bit] > 0)
+            fingerprint |= 1ULL << bit;
+    return fingerprint;
+}
+
+flood_detector::user_state& flood_detector::find_user(const std::string &user_key, std::chrono::steady_clock::time_point now) {
+    auto itr = this->user_index.find(user_key);
+    if (itr != this->user_index.end()) {
+        // Move to the front of the LRU list
+        this->users.splice(this->users.begin(), this->users, itr->second);
+        return *itr->second;
+    }
+    // Forget the least recently seen user if we're full, and reuse its entry
+    if (this->users.size() >= this->config.max_users && !this->users.empty()) {
+        this->user_index.erase(this->users.back().user_key);
+        this->users.splice(this->users.begin(), this->users, std::prev(this->users.end()));
+        this->users.front() = user_state();
+    } else {
+        this->users.emplace_front();
+    }
+    user_state &state = this->users.front();
+    state.user_key = user_key;
+    state.tokens = this->config.burst;
+    state.last_refill = now;
+    this->user_index[user_key] = this->users.begin();
+    return state;
+}
+
+void flood_detector::process(std::vector<message> &messages) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> guard(this->lock);
+
+    for (auto &msg : messages) {
+        // Users are told apart by provider too, since IDs of different platforms can collide
+        std::string user_key = msg.provider_id;
+        user_key.push_back('\n');
+        user_key.append(msg.user_id.empty() ? msg.user_name : msg.user_id);
+        user_state &user = this->find_user(user_key, now);
+        this->messages++;
+
+        // Token bucket
+        double elapsed = std::chrono::duration<double>(now - user.last_refill).count();
+        user.tokens = std::min(this->config.burst, user.tokens + elapsed * this->config.rate);
+        user.last_refill = now;
+        bool too_fast = user.tokens < 1;
+        if (!too_fast)
+            user.tokens -= 1;
+
+        // Compare with the user's recent messages
+        uint64_t fingerprint = simhash(msg.message);
+        int similar = 0;
+        for (size_t i=0; i<user.history_count; i++)
+            if (__builtin_popcountll(user.history[i] ^ fingerprint) <= this->config.similarity_distance)
+                similar++;
+        bool repeating = similar >= this->config.repeats_allowed;
+        user.history[user.history_next] = fingerprint;
+        user.history_next = (user.history_next + 1) % history_size;
+        user.history_count = std::min(user.history_count + 1, history_size);
+
+        // Annotate flagged messages
+        if (too_fast && repeating)
+            msg.more_metadata["flood"] = "rate,repeat";
+        else if (too_fast)
+            msg.more_metadata["flood"] = "rate";
+        else if (repeating)
+            msg.more_metadata["flood"] = "repeat";
+        if (too_fast)
+            this->flagged_rate++;
+        if (repeating)
+            this->flagged_repeat++;
+    }
+}
+
+void flood_detector::set_config(const flood_detector_config &config) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->config = config;
+    // Shrink the LRU if needed
+    while (this->users.size() > this->config.max_users) {
+        this->user_index.erase(this->users.back().user_key);
+        this->users.pop_back();
+    }
+}
+
+flood_detector_config flood_detector::get_config() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->config;
+}
+
+flood_detector_stats flood_detector::get_stats() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return {this->messages, this->flagged_rate, this->flagged_repeat, this->users.size()};
+}
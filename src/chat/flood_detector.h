@@ -0,0 +1,64 @@
+#ifndef STRTB_CHAT_FLOOD_DETECTOR_H
+#define STRTB_CHAT_FLOOD_DETECTOR_H
+
+#include "message.h"
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+namespace strtb::chat {
+
+struct flood_detector_config {
+    double rate = 1.0;              // Messages per second a user can keep sending
+    double burst = 5.0;             // Messages a user can send at once
+    int similarity_distance = 6;    // Max differing simhash bits (out of 64) for two messages to count as repeats
+    int repeats_allowed = 2;        // Similar recent messages a user can send before getting flagged
+    size_t max_users = 16384;       // Users that are tracked at once (least recently seen ones are forgotten)
+};
+
+struct flood_detector_stats {
+    uint64_t messages, flagged_rate, flagged_repeat;
+    size_t tracked_users;
+};
+
+/* Flags users who post too fast (token bucket) or keep repeating near-identical text (simhash).
+ * Flagged messages get a "flood" entry in their more_metadata, containing "rate", "repeat" or "rate,repeat".
+ * Memory is bounded by an LRU of users, and each message costs a fixed amount of work.
+ */
+class flood_detector {
+public:
+    static constexpr size_t history_size = 8;
+    static constexpr size_t max_shingles = 256;
+private:
+    struct user_state {
+        std::string user_key;
+        double tokens;
+        std::chrono::steady_clock::time_point last_refill;
+        std::array<uint64_t, history_size> history;
+        size_t history_count = 0, history_next = 0;
+    };
+
+    std::mutex lock;
+    flood_detector_config config;
+    std::list<user_state> users;    // Most recently seen first
+    std::unordered_map<std::string, std::list<user_state>::iterator> user_index;
+    uint64_t messages = 0, flagged_rate = 0, flagged_repeat = 0;
+
+    static uint64_t simhash(const std::string &text);
+    user_state& find_user(const std::string &user_key, std::chrono::steady_clock::time_point now);
+public:
+    flood_detector(const flood_detector_config &config = flood_detector_config());
+    void process(std::vector<message> &messages);
+    void set_config(const flood_detector_config &config);
+    flood_detector_config get_config();
+    flood_detector_stats get_stats();
+};
+
+}
+
+#endif // STRTB_CHAT_FLOOD_DETECTOR_H
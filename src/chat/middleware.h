@@ -0,0 +1,31 @@
+#ifndef STRTB_CHAT_MIDDLEWARE_H
+#define STRTB_CHAT_MIDDLEWARE_H
+
+#include "message.h"
+#include <string>
+#include <cstdint>
+
+namespace strtb::chat {
+
+/* A stage that runs on every incoming message before it's relayed to subscribers.
+ * It can modify or annotate the message in place, or return false to drop it.
+ * Stages run on the dispatcher thread, so they should be quick. A stage that throws is logged and skipped from then on.
+ */
+class middleware {
+protected:
+    virtual ~middleware() = default;
+public:
+    virtual bool process(message &message) = 0;
+};
+
+struct middleware_stats {
+    std::string name;
+    int order;
+    uint64_t batches, messages, dropped;
+    double total_time_us, max_batch_time_us;
+    bool failed;    // Threw an exception, so it's skipped until it's removed
+};
+
+}
+
+#endif // STRTB_CHAT_MIDDLEWARE_H
@@ -1,10 +1,12 @@
 #include "provider.h"
+#include "topology.h"
 
 using namespace strtb;
 using namespace strtb::chat;
 
-provider::provider(std::string id, std::string name, class queue *queue, deregistration_interface<provider*> *deregister)
-    : log("Chat Provider: " + id), queue(queue), deregister_provider(deregister), id(id), name(name) {}
+provider::provider(std::string id, std::string name, class queue *queue, deregistration_interface<provider*> *deregister,
+                   class topology *topology)
+    : log("Chat Provider: " + id), queue(queue), deregister_provider(deregister), topology(topology), id(id), name(name) {}
 
 std::string provider::get_id() {
     return this->id;
@@ -49,6 +51,8 @@ channel* provider::register_channel(std::string id, std::string name) {
     // Reguster new channel and return it
     channel = new class channel(this->id, this->name, id, name, this->queue, this);
     this->channels[id] = channel;
+    if (this->topology)
+        this->topology->channel_added(this->id, id, name);
     return channel;
 }
 
@@ -60,8 +64,11 @@ void provider::deregister(channel *object) {
     // Make sure the channel was actually registered
     if (itr == this->channels.end())
         this->log.put(logging::WARNING, {"Deregistering a channel that wasn't registered: ", object->get_provider_id(), ":", object->get_id()});
-    else
+    else {
         this->channels.erase(itr);
+        if (this->topology)
+            this->topology->channel_removed(this->id, id);
+    }
 }
 
 void provider::abandon() {
@@ -70,6 +77,7 @@ void provider::abandon() {
     // Our parent has abandoned us, so we and our children shouldn't do any more actions that communicate with the parent to avoid crashes
     this->queue = nullptr;
     this->deregister_provider = nullptr;
+    this->topology = nullptr;
     for (auto c_itr : this->channels)
         c_itr.second->abandon();
 }
@@ -11,6 +11,8 @@
 
 namespace strtb::chat {
 
+class topology;
+
 struct provider_info {
     std::string id, name;
     int channel_count;
@@ -22,6 +24,7 @@ private:
     logging::source log;
     class queue *queue;
     deregistration_interface<provider*> *deregister_provider;
+    class topology *topology;
     std::string id, name;
     std::map<std::string, channel*> channels;
     std::mutex lock;
@@ -29,7 +32,8 @@ protected:
     friend class system;
     void abandon();
 public:
-    provider(std::string id, std::string name, class queue *queue, deregistration_interface<provider*> *deregister_provider);
+    provider(std::string id, std::string name, class queue *queue, deregistration_interface<provider*> *deregister_provider,
+             class topology *topology = nullptr);
     ~provider();
     std::string get_id();
     std::string get_name();
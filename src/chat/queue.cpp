@@ -1,17 +1,27 @@
 #include "queue.h"
+#include <thread>
 
 using namespace strtb;
 using namespace strtb::chat;
 
+// Spinning only makes sense when the pusher can run at the same time as us
+static const bool can_spin = std::thread::hardware_concurrency() > 1;
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
 queue::queue() {}
 
 queue::~queue() {
-    {
-        // Mark for deletion and wake up thread that's waiting on this queue
-        std::lock_guard<std::mutex> guard(this->lock);
-        this->deleting = true;
-        this->wait.notify_one();
-    }
+    // Mark for deletion and wake up thread that's waiting on this queue
+    this->close();
     {
         // Delay object destruction until we're told it's safe to do it
         std::unique_lock<std::mutex> guard(this->deletion_lock);
@@ -20,6 +30,74 @@ queue::~queue() {
     }
 }
 
+void queue::spin_wait() {
+    // Busy-wait for a short while, since under load the next message usually comes in before parking would pay off.
+    // The spin limit adapts: it grows when spinning catches messages and shrinks when it doesn't, so an idle queue parks quickly.
+    if (!can_spin)
+        return;
+    // Pullers on different threads may spin at once; the limit is only a hint, so relaxed accesses are enough
+    int limit = this->spin_limit.load(std::memory_order_relaxed);
+    for (int i=0; i<limit; i++) {
+        if (this->count.load(std::memory_order_acquire)) {
+            this->spin_limit.store(std::min(limit * 2, max_spin), std::memory_order_relaxed);
+            return;
+        }
+        cpu_relax();
+    }
+    this->spin_limit.store(std::max(limit / 2, min_spin), std::memory_order_relaxed);
+}
+
+void queue::wait_locked(std::unique_lock<std::mutex> &guard) {
+    // Register as a waiter, so pushers know they need to notify us
+    this->waiters++;
+    this->wait.wait(guard);
+    this->waiters--;
+    this->woke_up();
+}
+
+void queue::woke_up() {
+    // Called with the lock held. Nothing to measure after spurious wake-ups or close().
+    if (this->notified_at == clock::time_point())
+        return;
+    this->last_wakeup_delay = clock::now() - this->notified_at;
+    this->notified_at = clock::time_point();
+}
+
+void queue::pushed() {
+    // Called with the lock held after adding messages
+    this->count.store(this->q.size(), std::memory_order_release);
+    // Skip the notification (and its syscall) if nobody is parked
+    if (this->waiters) {
+        // Keep the first notification's time if the puller hasn't run yet, since that's when it became runnable
+        if (this->notified_at == clock::time_point())
+            this->notified_at = clock::now();
+        this->wait.notify_one();
+        this->notifications++;
+    }
+}
+
+void queue::take_all(std::vector<message> &messages) {
+    // Called with the lock held
+    if (this->max_age != clock::duration::zero())
+        this->drop_expired(clock::now());
+    messages.reserve(this->q.size());
+    while (!this->q.empty()) {
+        messages.push_back(std::move(this->q.front().msg));
+        this->q.pop();
+    }
+    this->count.store(0, std::memory_order_release);
+}
+
+void queue::drop_expired(clock::time_point now) {
+    // Called with the lock held. Messages are in the order they were enqueued, so the expired ones are all at the front.
+    clock::time_point cutoff = now - this->max_age;
+    while (!this->q.empty() && this->q.front().enqueued < cutoff) {
+        this->q.pop();
+        this->expired++;
+    }
+    this->count.store(this->q.size(), std::memory_order_release);
+}
+
 bool queue::empty() {
     std::lock_guard<std::mutex> guard(this->lock);
     return this->q.empty();
@@ -32,39 +110,84 @@ int queue::size() {
 
 void queue::push(message &message) {
     std::lock_guard<std::mutex> guard(this->lock);
+    // Drop messages once closed
+    if (this->deleting)
+        return;
     // Push message into queue
-    q.push(message);
+    auto now = clock::now();
+    if (this->max_age != clock::duration::zero())
+        this->drop_expired(now);
+    q.push({message, now});
     // Notify threads waiting for messages
-    wait.notify_one();
+    this->pushed();
+}
+
+void queue::push(message &&message) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    // Drop messages once closed
+    if (this->deleting)
+        return;
+    // Move message into queue
+    auto now = clock::now();
+    if (this->max_age != clock::duration::zero())
+        this->drop_expired(now);
+    q.push({std::move(message), now});
+    // Notify threads waiting for messages
+    this->pushed();
 }
 
 void queue::push(std::vector<message> &messages) {
     std::lock_guard<std::mutex> guard(this->lock);
+    // Drop messages once closed
+    if (this->deleting)
+        return;
     // Push messages into queue
-    for (auto msg : messages)
-        q.push(msg);
+    auto now = clock::now();
+    if (this->max_age != clock::duration::zero())
+        this->drop_expired(now);
+    for (auto &msg : messages)
+        q.push({msg, now});
+    // Notify threads waiting for messages
+    this->pushed();
+}
+
+void queue::push(std::vector<message> &&messages) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    // Drop messages once closed
+    if (this->deleting)
+        return;
+    // Move messages into queue
+    auto now = clock::now();
+    if (this->max_age != clock::duration::zero())
+        this->drop_expired(now);
+    for (auto &msg : messages)
+        q.push({std::move(msg), now});
     // Notify threads waiting for messages
-    wait.notify_one();
+    this->pushed();
 }
 
 std::vector<message> queue::pull() {
-    std::unique_lock<std::mutex> guard(this->lock);
     std::vector<message> messages;
+    // Spin for a bit before going for the lock and possibly parking
+    if (!this->count.load(std::memory_order_acquire))
+        this->spin_wait();
+    std::unique_lock<std::mutex> guard(this->lock);
+    this->last_wakeup_delay = clock::duration::zero();
     // Abort if the queue is being deleted
     if (deleting)
         return messages;
-    // Wait for new messages to come in, or for the queue to be deleted
-    if (this->q.empty())
-        this->wait.wait(guard);
-    // Abort if the interruption was due to the queue being deleted
-    if (deleting)
-        return messages;
-    // Otherwise, grab new messages and return them
-    while (!this->q.empty()) {
-        messages.push_back(this->q.front());
-        this->q.pop();
+    while (true) {
+        // Wait for new messages to come in, or for the queue to be deleted (ignoring spurious wake-ups)
+        while (this->q.empty() && !this->deleting)
+            this->wait_locked(guard);
+        // Abort if the interruption was due to the queue being deleted
+        if (deleting)
+            return messages;
+        // Otherwise, grab new messages and return them (unless they all expired, since an empty result means deletion)
+        this->take_all(messages);
+        if (!messages.empty())
+            return messages;
     }
-    return messages;
 }
 
 std::vector<message> queue::pull_instantly() {
@@ -74,13 +197,100 @@ std::vector<message> queue::pull_instantly() {
     if (deleting)
         return messages;
     // Grab any new messages (possibly none), and return them
-    while (!this->q.empty()) {
-        messages.push_back(this->q.front());
-        this->q.pop();
+    this->take_all(messages);
+    return messages;
+}
+
+std::vector<message> queue::pull_until(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> guard(this->lock);
+    std::vector<message> messages;
+    this->last_wakeup_delay = clock::duration::zero();
+    // Wait for new messages to come in, for the queue to be deleted, or for the deadline to pass
+    while (this->q.empty() && !this->deleting) {
+        this->waiters++;
+        std::cv_status status = this->wait.wait_until(guard, deadline);
+        this->waiters--;
+        this->woke_up();
+        if (status == std::cv_status::timeout)
+            break;
+    }
+    // Abort if the queue is being deleted
+    if (deleting)
+        return messages;
+    // Grab any new messages (possibly none on timeout), and return them
+    this->take_all(messages);
+    return messages;
+}
+
+std::vector<aged_message> queue::copy_all() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    std::vector<aged_message> messages;
+    // Copy pending messages without taking them out of the queue
+    auto now = clock::now();
+    if (this->max_age != clock::duration::zero())
+        this->drop_expired(now);
+    std::queue<entry> copy = this->q;
+    messages.reserve(copy.size());
+    while (!copy.empty()) {
+        auto age = std::chrono::duration_cast<std::chrono::milliseconds>(now - copy.front().enqueued);
+        messages.push_back({std::move(copy.front().msg), age});
+        copy.pop();
     }
     return messages;
 }
 
+void queue::push_aged(std::vector<aged_message> &&messages) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    // Drop messages once closed
+    if (this->deleting)
+        return;
+    // Backdate the messages, so they expire when they would have if they had never left
+    auto now = clock::now();
+    for (auto &item : messages)
+        q.push({std::move(item.msg), now - clock::duration(item.age)});
+    if (this->max_age != clock::duration::zero())
+        this->drop_expired(now);
+    // Notify threads waiting for messages
+    this->pushed();
+}
+
+std::chrono::steady_clock::duration queue::get_last_wakeup_delay() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->last_wakeup_delay;
+}
+
+bool queue::is_deleting() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->deleting;
+}
+
+void queue::close() {
+    // Acts like the queue is being deleted: waiting threads wake up empty-handed, and new messages are dropped
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->deleting = true;
+    this->wait.notify_all();
+}
+
+void queue::set_max_age(std::chrono::milliseconds max_age) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->max_age = max_age.count() > 0 ? clock::duration(max_age) : clock::duration::zero();
+}
+
+std::chrono::milliseconds queue::get_max_age() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(this->max_age);
+}
+
+uint64_t queue::get_expired_count() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->expired;
+}
+
+uint64_t queue::get_notify_count() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return this->notifications;
+}
+
 void queue::block_deletion() {
     std::lock_guard<std::mutex> guard(this->deletion_lock);
     deletion_allowed = false;
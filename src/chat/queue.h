@@ -5,28 +5,78 @@
 #include <queue>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
 #include "message.h"
 
 namespace strtb::chat {
 
+// A pending message along with how long it has been waiting, so it can be saved and put back without resetting its age
+struct aged_message {
+    message msg;
+    std::chrono::milliseconds age;
+};
+
 class queue {
 private:
-    std::queue<message> q;
+    typedef std::chrono::steady_clock clock;
+    struct entry {
+        message msg;
+        clock::time_point enqueued;
+    };
+    std::queue<entry> q;
     std::mutex lock;
     std::condition_variable wait;
+    // Adaptive waiting: pullers spin briefly before parking, and pushers only notify when someone is parked
+    std::atomic<size_t> count = 0;
+    int waiters = 0;
+    uint64_t notifications = 0;
+    std::atomic<int> spin_limit = max_spin;
     bool deletion_allowed = true;
     bool deleting = false;
     std::mutex deletion_lock;
     std::condition_variable deletion_wait;
+    // Optional expiry: messages that waited longer than this are dropped instead of being handed out (0 = off)
+    clock::duration max_age = clock::duration::zero();
+    uint64_t expired = 0;
+    // Wakeup latency: when a push notified a parked puller, and how long that puller took to run again
+    clock::time_point notified_at;
+    clock::duration last_wakeup_delay = clock::duration::zero();
+
+    void spin_wait();
+    void wait_locked(std::unique_lock<std::mutex> &guard);
+    void woke_up();
+    void pushed();
+    void take_all(std::vector<message> &messages);
+    void drop_expired(clock::time_point now);
 public:
+    static constexpr int max_spin = 4096;
+    static constexpr int min_spin = 64;
+
     queue();
     ~queue();
     bool empty();
     int size();
     void push(message &message);
+    void push(message &&message);
     void push(std::vector<message> &messages);
+    void push(std::vector<message> &&messages);
     std::vector<message> pull();
     std::vector<message> pull_instantly();
+    std::vector<message> pull_until(std::chrono::steady_clock::time_point deadline);
+    std::vector<aged_message> copy_all();
+    // Puts back messages that were taken out with copy_all(), oldest first (only for queues that are still empty)
+    void push_aged(std::vector<aged_message> &&messages);
+    // How long the last pull took to run again after a push woke it up (zero if it didn't have to park)
+    std::chrono::steady_clock::duration get_last_wakeup_delay();
+    bool is_deleting();
+    void close();
+    void set_max_age(std::chrono::milliseconds max_age);
+    std::chrono::milliseconds get_max_age();
+    uint64_t get_expired_count();
+    // Times a push had to wake up a parked puller (pushes skip it when nobody is parked)
+    uint64_t get_notify_count();
     void block_deletion();
     void allow_deletion();
 };
@@ -0,0 +1,143 @@
+#include "scheduling.h"
+#include "../config/system.h"
+#include "../json/all_value_types.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+using namespace strtb;
+using namespace strtb::chat;
+
+scheduling_config chat::read_scheduling_config(config::system &config, const std::string &category, const std::string &prefix) {
+    scheduling_config result;
+    if (config.get_type(category, {prefix + "cpus"}) == json::VAL_ARRAY) {
+        json::value *cpus = config.get_value(category, {prefix + "cpus"});
+        json::value_array *array = (json::value_array*) cpus;
+        for (size_t i=0; i<array->size(); i++) {
+            json::value &cpu = array->at(i);
+            if (cpu.type() == json::VAL_INT)
+                result.cpus.push_back(((json::value_int&) cpu).value());
+        }
+        delete cpus;
+    }
+    if (config.get_type(category, {prefix + "policy"}) == json::VAL_STRING) {
+        json::value *policy = config.get_value(category, {prefix + "policy"});
+        result.policy = ((json::value_string*) policy)->value();
+        delete policy;
+    }
+    if (config.get_type(category, {prefix + "priority"}) == json::VAL_INT) {
+        json::value *priority = config.get_value(category, {prefix + "priority"});
+        result.priority = ((json::value_int*) priority)->value();
+        delete priority;
+    }
+    if (config.get_type(category, {prefix + "nice"}) == json::VAL_INT) {
+        json::value *nice = config.get_value(category, {prefix + "nice"});
+        result.change_nice = true;
+        result.nice = ((json::value_int*) nice)->value();
+        delete nice;
+    }
+    return result;
+}
+
+long chat::current_thread_id() {
+#ifdef __linux__
+    return syscall(SYS_gettid);
+#else
+    return 0;
+#endif
+}
+
+void chat::apply_scheduling(std::thread::native_handle_type thread, long thread_id, const scheduling_config &config) {
+#ifdef __linux__
+    // CPU affinity
+    if (!config.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : config.cpus) {
+            if (cpu < 0 || cpu >= CPU_SETSIZE)
+                throw std::invalid_argument("Invalid CPU number: " + std::to_string(cpu));
+            CPU_SET(cpu, &set);
+        }
+        int error = pthread_setaffinity_np(thread, sizeof(set), &set);
+        if (error)
+            throw std::runtime_error(std::string("Couldn't set CPU affinity: ") + strerror(error));
+    }
+    // Scheduling policy
+    if (!config.policy.empty()) {
+        int policy;
+        if (config.policy == "other")
+            policy = SCHED_OTHER;
+        else if (config.policy == "batch")
+            policy = SCHED_BATCH;
+        else if (config.policy == "idle")
+            policy = SCHED_IDLE;
+        else if (config.policy == "fifo")
+            policy = SCHED_FIFO;
+        else if (config.policy == "rr")
+            policy = SCHED_RR;
+        else
+            throw std::invalid_argument("Unknown scheduling policy: " + config.policy);
+        sched_param param = {};
+        param.sched_priority = (policy == SCHED_FIFO || policy == SCHED_RR) ? config.priority : 0;
+        int error = pthread_setschedparam(thread, policy, &param);
+        if (error)
+            throw std::runtime_error("Couldn't set scheduling policy " + config.policy + ": " + strerror(error));
+    }
+    // Nice level (per thread on Linux)
+    if (config.change_nice) {
+        if (setpriority(PRIO_PROCESS, thread_id, config.nice) != 0)
+            throw std::runtime_error(std::string("Couldn't set nice level: ") + strerror(errno));
+    }
+#else
+    if (!config.cpus.empty() || !config.policy.empty() || config.change_nice)
+        throw std::runtime_error("Thread scheduling options are only supported on Linux");
+#endif
+}
+
+void latency_histogram::add(std::chrono::steady_clock::duration latency) {
+    double us = std::chrono::duration<double, std::micro>(latency).count();
+    if (us < 0)
+        us = 0;
+    // Bucket 0 is under 1 µs, bucket n is [2^(n-1), 2^n) µs, and the last one takes everything above
+    int bucket = 0;
+    for (uint64_t limit = 1; bucket < buckets - 1 && us >= limit; limit <<= 1)
+        bucket++;
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->counts[bucket]++;
+    this->samples++;
+    this->total_us += us;
+    if (us > this->max_us)
+        this->max_us = us;
+}
+
+double latency_histogram::percentile(double fraction) const {
+    // Called with the lock held. Reports the upper bound of the bucket the percentile falls in.
+    uint64_t wanted = this->samples * fraction;
+    uint64_t seen = 0;
+    for (int bucket=0; bucket<buckets; bucket++) {
+        seen += this->counts[bucket];
+        if (seen > wanted)
+            return std::min((double) (1ULL << bucket), this->max_us);
+    }
+    return this->max_us;
+}
+
+latency_stats latency_histogram::get_stats() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return {this->samples, this->samples ? this->total_us / this->samples : 0, this->max_us, this->percentile(0.5),
+            this->percentile(0.99)};
+}
+
+void latency_histogram::reset() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->counts = {};
+    this->samples = 0;
+    this->total_us = 0;
+    this->max_us = 0;
+}
@@ -0,0 +1,62 @@
+#ifndef STRTB_CHAT_SCHEDULING_H
+#define STRTB_CHAT_SCHEDULING_H
+
+#include <string>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+
+namespace strtb::config {
+class system;
+}
+
+namespace strtb::chat {
+
+struct scheduling_config {
+    std::vector<int> cpus;      // CPUs the thread may run on (empty = any)
+    std::string policy;         // "other", "batch", "idle", "fifo" or "rr" (empty = leave as is)
+    int priority = 0;           // Real-time priority, for "fifo" and "rr" (1-99)
+    bool change_nice = false;
+    int nice = 0;               // Nice level (-20 to 19), applied if change_nice is set
+};
+
+/* Reads scheduling options from a config category. All keys are optional:
+ *   <prefix>cpus      array of CPU numbers
+ *   <prefix>policy    scheduling policy name
+ *   <prefix>priority  real-time priority
+ *   <prefix>nice      nice level
+ */
+scheduling_config read_scheduling_config(config::system &config, const std::string &category, const std::string &prefix);
+
+// Applies to a thread, given its handle and its kernel thread ID (for the nice level). Throws on failure.
+void apply_scheduling(std::thread::native_handle_type thread, long thread_id, const scheduling_config &config);
+long current_thread_id();
+
+struct latency_stats {
+    uint64_t samples;
+    double average_us, max_us;
+    double p50_us, p99_us;      // Estimated from a histogram with power-of-two buckets
+};
+
+/* Histogram of latencies, in power-of-two microsecond buckets (from <1 µs to over a minute). */
+class latency_histogram {
+public:
+    static constexpr int buckets = 28;
+private:
+    std::mutex lock;
+    std::array<uint64_t, buckets> counts = {};
+    uint64_t samples = 0;
+    double total_us = 0, max_us = 0;
+    double percentile(double fraction) const;
+public:
+    void add(std::chrono::steady_clock::duration latency);
+    latency_stats get_stats();
+    void reset();
+};
+
+}
+
+#endif // STRTB_CHAT_SCHEDULING_H
@@ -0,0 +1,172 @@
+#include "search_index.h"
+#include "tokenizer.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace strtb;
+using namespace strtb::chat;
+
+static long long current_time_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static std::string to_lower(std::string str) {
+    for (char &c : str)
+        if ('A' <= c && c <= 'Z')
+            c = c - 'A' + 'a';
+    return str;
+}
+
+search_index::search_index(const search_index_config &config) : config(config) {}
+
+search_index::~search_index() {
+    for (segment *seg : this->segments)
+        delete seg;
+}
+
+void search_index::evict(long long now) {
+    // Called with the lock held. Drops whole segments, oldest first, but never the one being filled.
+    while (this->segments.size() > 1 &&
+           (this->segments.size() > this->config.max_segments ||
+            (this->config.max_age_ms > 0 && this->segments.front()->times.back() < now - this->config.max_age_ms))) {
+        this->stored -= this->segments.front()->messages.size();
+        delete this->segments.front();
+        this->segments.pop_front();
+        this->evicted++;
+    }
+}
+
+void search_index::process(const std::vector<message> &messages) {
+    long long now = current_time_ms();
+    std::lock_guard<std::mutex> guard(this->lock);
+    for (auto &msg : messages) {
+        // Start a new segment when the current one is full
+        if (this->segments.empty() || this->segments.back()->messages.size() >= this->config.segment_messages) {
+            this->segments.push_back(new segment);
+            this->segments.back()->messages.reserve(this->config.segment_messages);
+            this->segments.back()->times.reserve(this->config.segment_messages);
+            this->evict(now);
+        }
+        segment &seg = *this->segments.back();
+        uint32_t doc = seg.messages.size();
+        seg.messages.push_back(msg);
+        // Indexing times must not go backwards, since time ranges are found by binary search
+        seg.times.push_back(seg.times.empty() ? now : std::max(now, seg.times.back()));
+
+        // Each word is only listed once per message, so posting lists stay sorted and unique
+        std::vector<std::string> terms = split_words(msg.message, max_terms_per_message, true);
+        std::sort(terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+        for (auto &term : terms)
+            seg.terms[term].push_back(doc);
+        // Users can be found by ID or by name
+        std::string user_id = to_lower(msg.user_id), user_name = to_lower(msg.user_name);
+        if (!user_id.empty())
+            seg.users[user_id].push_back(doc);
+        if (!user_name.empty() && user_name != user_id)
+            seg.users[user_name].push_back(doc);
+        this->stored++;
+        this->indexed++;
+    }
+    // Age out old segments even when chat is slow
+    if (!messages.empty())
+        this->evict(now);
+}
+
+void search_index::search_segment(const segment &seg, const search_query &query, const std::vector<std::string> &terms,
+                                  const std::string &user, std::vector<search_result> &results) {
+    // Only messages in the wanted time range, found by binary search
+    uint32_t first = query.since_ms ? std::lower_bound(seg.times.begin(), seg.times.end(), query.since_ms) - seg.times.begin() : 0;
+    uint32_t last = query.until_ms ? std::upper_bound(seg.times.begin(), seg.times.end(), query.until_ms) - seg.times.begin()
+                                   : seg.times.size();
+    if (first >= last)
+        return;
+
+    // Gather the posting lists that need to match; if one is missing, nothing in this segment matches
+    std::vector<const std::vector<uint32_t>*> lists;
+    for (auto &term : terms) {
+        auto itr = seg.terms.find(term);
+        if (itr == seg.terms.end())
+            return;
+        lists.push_back(&itr->second);
+    }
+    if (!user.empty()) {
+        auto itr = seg.users.find(user);
+        if (itr == seg.users.end())
+            return;
+        lists.push_back(&itr->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](auto a, auto b) {return a->size() < b->size();});
+
+    auto matches = [&](uint32_t doc) {
+        const message &msg = seg.messages[doc];
+        if (!query.provider_id.empty() && msg.provider_id != query.provider_id)
+            return false;
+        if (!query.channel_id.empty() && msg.channel_id != query.channel_id)
+            return false;
+        // Check the other posting lists (the shortest one is being walked through)
+        for (size_t i=1; i<lists.size(); i++)
+            if (!std::binary_search(lists[i]->begin(), lists[i]->end(), doc))
+                return false;
+        return true;
+    };
+
+    if (lists.empty()) {
+        // No words or user to look for, so walk through the time range
+        for (uint32_t doc = last; doc > first && results.size() < query.limit; doc--)
+            if (matches(doc - 1))
+                results.push_back({seg.messages[doc - 1], seg.times[doc - 1]});
+        return;
+    }
+    // Walk the shortest posting list newest first, limited to the time range
+    const std::vector<uint32_t> &shortest = *lists[0];
+    auto begin = std::lower_bound(shortest.begin(), shortest.end(), first);
+    auto itr = std::lower_bound(begin, shortest.end(), last);
+    while (itr != begin && results.size() < query.limit) {
+        uint32_t doc = *--itr;
+        if (matches(doc))
+            results.push_back({seg.messages[doc], seg.times[doc]});
+    }
+}
+
+std::vector<search_result> search_index::search(const search_query &query) {
+    std::vector<search_result> results;
+    std::vector<std::string> terms = split_words(query.text, max_terms_per_message, true);
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    std::string user = to_lower(query.user);
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    // Newest segments first, skipping the ones outside the time range
+    for (auto itr = this->segments.rbegin(); itr != this->segments.rend() && results.size() < query.limit; itr++) {
+        const segment &seg = **itr;
+        if (seg.times.empty())
+            continue;
+        if (query.since_ms && seg.times.back() < query.since_ms)
+            break;
+        if (query.until_ms && seg.times.front() > query.until_ms)
+            continue;
+        search_segment(seg, query, terms, user, results);
+    }
+    return results;
+}
+
+void search_index::set_config(const search_index_config &config) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->config = config;
+    this->evict(current_time_ms());
+}
+
+search_index_stats search_index::get_stats() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return {this->indexed, this->stored, this->segments.size(), this->evicted};
+}
+
+void search_index::clear() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    for (segment *seg : this->segments)
+        delete seg;
+    this->segments.clear();
+    this->stored = 0;
+}
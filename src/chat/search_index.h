@@ -0,0 +1,74 @@
+#ifndef STRTB_CHAT_SEARCH_INDEX_H
+#define STRTB_CHAT_SEARCH_INDEX_H
+
+#include "message.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+namespace strtb::chat {
+
+struct search_index_config {
+    size_t segment_messages = 32768;            // Messages per segment
+    size_t max_segments = 32;                   // Oldest segment is evicted when there's more (bounds memory)
+    long long max_age_ms = 6 * 60 * 60 * 1000;  // Segments with only older messages are evicted too (0 = keep)
+};
+
+struct search_query {
+    std::string text;                   // Words that all need to be in the message (case-insensitive), or empty
+    std::string user;                   // User ID or user name (case-insensitive), or empty for any user
+    std::string provider_id, channel_id;    // Empty for any
+    long long since_ms = 0, until_ms = 0;   // Time range the messages were indexed in (0 = unbounded)
+    size_t limit = 100;
+};
+
+struct search_result {
+    message msg;
+    long long indexed_at_ms;    // When the message went through the dispatcher (ms since the Unix epoch)
+};
+
+struct search_index_stats {
+    uint64_t indexed_messages;  // Total since enabled
+    size_t stored_messages, segments, evicted_segments;
+};
+
+/* In-memory inverted index over recent chat messages, so moderators can search history quickly.
+ * Messages are appended to fixed-size segments, each with posting lists of its messages per word and per user.
+ * Posting lists are in arrival order, so queries intersect them newest first and stop once they have enough results.
+ * Memory is bounded by evicting whole segments, which also makes eviction O(1) per message.
+ */
+class search_index {
+public:
+    static constexpr size_t max_terms_per_message = 64;
+private:
+    struct segment {
+        std::vector<message> messages;
+        std::vector<long long> times;   // Indexing time of each message, non-decreasing
+        std::unordered_map<std::string, std::vector<uint32_t>> terms, users;
+    };
+
+    std::mutex lock;
+    search_index_config config;
+    std::deque<segment*> segments;  // Oldest first
+    uint64_t indexed = 0, evicted = 0;
+    size_t stored = 0;
+
+    void evict(long long now);
+    static void search_segment(const segment &seg, const search_query &query, const std::vector<std::string> &terms,
+                               const std::string &user, std::vector<search_result> &results);
+public:
+    search_index(const search_index_config &config = search_index_config());
+    ~search_index();
+    void process(const std::vector<message> &messages);
+    std::vector<search_result> search(const search_query &query);
+    void set_config(const search_index_config &config);
+    search_index_stats get_stats();
+    void clear();
+};
+
+}
+
+#endif // STRTB_CHAT_SEARCH_INDEX_H
@@ -0,0 +1,223 @@
+#include "snapshot.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <cstdint>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace strtb;
+using namespace strtb::chat;
+
+static uint64_t checksum(const char *data, size_t size) {
+    // FNV-1a, to catch truncated or corrupted files
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i=0; i<size; i++) {
+        h ^= (unsigned char) data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static void put_int(std::string &out, uint64_t value, int bytes) {
+    for (int i=0; i<bytes; i++)
+        out.push_back((char) (value >> (i * 8)));
+}
+
+static void put_string(std::string &out, const std::string &str) {
+    put_int(out, str.size(), 4);
+    out.append(str);
+}
+
+static void put_message(std::string &out, const message &msg) {
+    for (const std::string *str : {&msg.provider_id, &msg.provider_name, &msg.channel_id, &msg.channel_name,
+                                   &msg.user_id, &msg.user_name, &msg.user_color, &msg.message})
+        put_string(out, *str);
+    put_int(out, (msg.is_mod ? 1 : 0) | (msg.is_broadcaster ? 2 : 0) | (msg.is_paid_member ? 4 : 0), 1);
+    put_int(out, msg.timestamp, 8);
+    put_int(out, msg.more_metadata.size(), 4);
+    for (auto &item : msg.more_metadata) {
+        put_string(out, item.first);
+        put_string(out, item.second);
+    }
+}
+
+namespace {
+
+// Bounds-checked reading of a snapshot's contents
+class reader {
+private:
+    const std::string &data;
+    size_t pos;
+    size_t end;
+public:
+    reader(const std::string &data, size_t pos, size_t end) : data(data), pos(pos), end(end) {}
+
+    uint64_t get_int(int bytes) {
+        if (end - pos < (size_t) bytes)
+            throw std::runtime_error("Snapshot is truncated");
+        uint64_t value = 0;
+        for (int i=0; i<bytes; i++)
+            value |= (uint64_t) (unsigned char) data[pos++] << (i * 8);
+        return value;
+    }
+
+    size_t get_count() {
+        // Every item takes at least a byte, so bigger counts than the remaining data can't be valid
+        size_t count = this->get_int(4);
+        if (count > end - pos)
+            throw std::runtime_error("Snapshot has an invalid item count");
+        return count;
+    }
+
+    std::string get_string() {
+        size_t size = this->get_int(4);
+        if (end - pos < size)
+            throw std::runtime_error("Snapshot is truncated");
+        std::string str = data.substr(pos, size);
+        pos += size;
+        return str;
+    }
+
+    message get_message() {
+        message msg;
+        for (std::string *str : {&msg.provider_id, &msg.provider_name, &msg.channel_id, &msg.channel_name,
+                                 &msg.user_id, &msg.user_name, &msg.user_color, &msg.message})
+            *str = this->get_string();
+        int flags = this->get_int(1);
+        msg.is_mod = flags & 1;
+        msg.is_broadcaster = flags & 2;
+        msg.is_paid_member = flags & 4;
+        msg.timestamp = (long long) this->get_int(8);
+        size_t metadata_count = this->get_count();
+        for (size_t i=0; i<metadata_count; i++) {
+            std::string key = this->get_string();
+            msg.more_metadata[key] = this->get_string();
+        }
+        return msg;
+    }
+
+    bool at_end() {
+        return pos == end;
+    }
+};
+
+}
+
+void snapshot::write_to_file(const std::filesystem::path &path) const {
+    std::string out(magic, sizeof(magic) - 1);
+    put_int(out, std::chrono::duration_cast<std::chrono::milliseconds>(this->saved_at.time_since_epoch()).count(), 8);
+    // Providers and their channels
+    put_int(out, this->providers.size(), 4);
+    for (auto &provider : this->providers) {
+        put_string(out, provider.id);
+        put_string(out, provider.name);
+        put_int(out, provider.channels.size(), 4);
+        for (auto &channel : provider.channels) {
+            put_string(out, channel.id);
+            put_string(out, channel.name);
+        }
+    }
+    // Subscription queues and their contents
+    put_int(out, this->queues.size(), 4);
+    for (auto &queue : this->queues) {
+        put_string(out, queue.provider_id);
+        put_string(out, queue.channel_id);
+        put_int(out, queue.max_age.count(), 8);
+        put_int(out, queue.messages.size(), 4);
+        for (auto &item : queue.messages) {
+            put_message(out, item.msg);
+            put_int(out, item.age.count(), 8);
+        }
+    }
+    put_int(out, checksum(out.data(), out.size()), 8);
+
+    // Write to a temporary file, and replace the old snapshot with it once it's complete and on disk
+    std::filesystem::path tmp_path = path;
+    tmp_path += ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "Couldn't create " + tmp_path.string());
+    const char *data = out.data();
+    size_t left = out.size();
+    while (left > 0) {
+        ssize_t count = write(fd, data, left);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "Couldn't write " + tmp_path.string());
+        }
+        data += count;
+        left -= count;
+    }
+    if (fsync(fd) != 0) {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "Couldn't sync " + tmp_path.string());
+    }
+    if (close(fd) != 0)
+        throw std::system_error(errno, std::generic_category(), "Couldn't close " + tmp_path.string());
+    std::filesystem::rename(tmp_path, path);
+}
+
+snapshot snapshot::read_from_file(const std::filesystem::path &path) {
+    std::string data;
+    {
+        std::ifstream file(path, std::ios::binary);
+        file.exceptions(std::istream::failbit | std::istream::badbit);
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        data = buffer.str();
+    }
+    // Check the header and the checksum before trusting anything in it
+    const size_t magic_size = sizeof(magic) - 1;
+    if (data.size() < magic_size + 8)
+        throw std::runtime_error("Not a chat snapshot file");
+    if (data.compare(0, magic_size, magic) != 0)
+        throw std::runtime_error("Not a chat snapshot file");
+    size_t end = data.size() - 8;
+    if (reader(data, end, data.size()).get_int(8) != checksum(data.data(), end))
+        throw std::runtime_error("Snapshot checksum doesn't match");
+
+    snapshot result;
+    reader in(data, magic_size, end);
+    result.saved_at = std::chrono::system_clock::time_point(std::chrono::milliseconds((long long) in.get_int(8)));
+    size_t provider_count = in.get_count();
+    for (size_t i=0; i<provider_count; i++) {
+        provider_info provider;
+        provider.id = in.get_string();
+        provider.name = in.get_string();
+        size_t channel_count = in.get_count();
+        provider.channel_count = channel_count;
+        for (size_t j=0; j<channel_count; j++) {
+            channel_info channel;
+            channel.id = in.get_string();
+            channel.name = in.get_string();
+            provider.channels.push_back(channel);
+        }
+        result.providers.push_back(std::move(provider));
+    }
+    size_t queue_count = in.get_count();
+    for (size_t i=0; i<queue_count; i++) {
+        snapshot_queue queue;
+        queue.provider_id = in.get_string();
+        queue.channel_id = in.get_string();
+        queue.max_age = std::chrono::milliseconds((long long) in.get_int(8));
+        size_t message_count = in.get_count();
+        queue.messages.reserve(message_count);
+        for (size_t j=0; j<message_count; j++) {
+            message msg = in.get_message();
+            std::chrono::milliseconds age((long long) in.get_int(8));
+            queue.messages.push_back({std::move(msg), age});
+        }
+        result.queues.push_back(std::move(queue));
+    }
+    if (!in.at_end())
+        throw std::runtime_error("Snapshot has unexpected trailing data");
+    return result;
+}
@@ -0,0 +1,39 @@
+#ifndef STRTB_CHAT_SNAPSHOT_H
+#define STRTB_CHAT_SNAPSHOT_H
+
+#include "message.h"
+#include "queue.h"
+#include "provider.h"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+
+namespace strtb::chat {
+
+struct snapshot_queue {
+    std::string provider_id, channel_id;    // What the subscription was subscribed to
+    std::chrono::milliseconds max_age;
+    std::vector<aged_message> messages;     // Pending messages with how long they had been waiting, oldest first
+};
+
+/* Saved state of the chat system, in a compact binary file:
+ * magic, time of saving, registered providers with their channels, subscription queues with their pending
+ * messages (each followed by its age), checksum. Numbers are little-endian and strings are length-prefixed.
+ * Files are written to a temporary file and synced first, and then renamed over the old one, so a crash while
+ * saving never leaves a half-written snapshot behind.
+ */
+struct snapshot {
+    static constexpr char magic[9] = "STRTBCS2";
+
+    std::chrono::system_clock::time_point saved_at;
+    std::vector<provider_info> providers;
+    std::vector<snapshot_queue> queues;
+
+    void write_to_file(const std::filesystem::path &path) const;
+    static snapshot read_from_file(const std::filesystem::path &path);
+};
+
+}
+
+#endif // STRTB_CHAT_SNAPSHOT_H
@@ -0,0 +1,361 @@
+#include "sse_server.h"
+#include "../json/all_value_types.h"
+#include "../config/system.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+using namespace strtb;
+using namespace strtb::chat;
+
+static const char *response_ok = "HTTP/1.1 200 OK\r\n"
+                                 "Content-Type: text/event-stream\r\n"
+                                 "Cache-Control: no-cache\r\n"
+                                 "Connection: keep-alive\r\n"
+                                 "Access-Control-Allow-Origin: *\r\n"
+                                 "\r\n"
+                                 "retry: 1000\n\n";
+static const char *response_not_found = "HTTP/1.1 404 Not Found\r\n"
+                                        "Content-Length: 0\r\n"
+                                        "Connection: close\r\n"
+                                        "\r\n";
+static const size_t max_request_size = 8192;
+
+sse_config chat::read_sse_config(config::system &config, const std::string &category, const std::string &prefix) {
+    sse_config result;
+    if (config.get_type(category, {prefix + "enabled"}) == json::VAL_BOOL) {
+        json::value *enabled = config.get_value(category, {prefix + "enabled"});
+        result.enabled = ((json::value_bool*) enabled)->value();
+        delete enabled;
+    }
+    if (config.get_type(category, {prefix + "port"}) == json::VAL_INT) {
+        json::value *port = config.get_value(category, {prefix + "port"});
+        long long number = ((json::value_int*) port)->value();
+        delete port;
+        if (number < 0 || number > 65535)
+            throw std::out_of_range("Invalid port for chat events: " + std::to_string(number));
+        result.port = number;
+    }
+    return result;
+}
+
+sse_server::sse_server(class system *chat, uint16_t port, std::chrono::milliseconds frame_interval)
+    : log("Chat SSE Server"), chat(chat), port(port), frame_interval(frame_interval) {
+    // Listen on loopback only; overlays run on the same machine
+    try {
+        if (pipe2(this->wake_pipe, O_NONBLOCK | O_CLOEXEC) != 0)
+            throw std::runtime_error(std::string("Couldn't create wake-up pipe: ") + std::strerror(errno));
+        this->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (this->listen_fd < 0)
+            throw std::runtime_error(std::string("Couldn't create socket: ") + std::strerror(errno));
+        int reuse = 1;
+        setsockopt(this->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(this->listen_fd, (sockaddr*) &addr, sizeof(addr)) != 0)
+            throw std::runtime_error("Couldn't bind to port " + std::to_string(port) + ": " + std::strerror(errno));
+        if (listen(this->listen_fd, 16) != 0)
+            throw std::runtime_error(std::string("Couldn't listen on socket: ") + std::strerror(errno));
+        // Find out which port we actually got (in case port 0 was requested)
+        socklen_t addr_len = sizeof(addr);
+        if (getsockname(this->listen_fd, (sockaddr*) &addr, &addr_len) == 0)
+            this->port = ntohs(addr.sin_port);
+        // Subscribe to all chat
+        this->sub = this->chat->subscribe("", "");
+    } catch (std::exception &e) {
+        this->log.put(logging::ERROR, {"Couldn't start: ", e.what()});
+        this->close_all();
+        throw;
+    }
+
+    // Start threads
+    this->running = true;
+    this->last_write = std::chrono::steady_clock::now();
+    this->pull_thread = new std::thread(this->pull_handler, this);
+    this->serve_thread = new std::thread(this->serve_handler, this);
+    this->log.put(logging::INFO, {"Serving chat events on http://127.0.0.1:", (uint32_t) this->port, "/chat"});
+}
+
+sse_server::~sse_server() {
+    // Unsubscribing makes the pulling thread return
+    this->sub->unsubscribe();
+    this->pull_thread->join();
+    delete this->pull_thread;
+    delete this->sub;
+    // Wake up and stop the serving thread
+    this->running = false;
+    if (write(this->wake_pipe[1], "x", 1) < 0)
+        this->log.put(logging::WARNING, {"Couldn't wake up serving thread: ", std::strerror(errno)});
+    this->serve_thread->join();
+    delete this->serve_thread;
+    this->close_all();
+}
+
+uint16_t sse_server::get_port() {
+    return this->port;
+}
+
+size_t sse_server::client_count() {
+    return this->connected;
+}
+
+std::string sse_server::encode_message(const message &msg, unsigned long long id) {
+    json::value_object obj;
+    obj.set("provider_id", msg.provider_id);
+    obj.set("provider_name", msg.provider_name);
+    obj.set("channel_id", msg.channel_id);
+    obj.set("channel_name", msg.channel_name);
+    obj.set("user_id", msg.user_id);
+    obj.set("user_name", msg.user_name);
+    obj.set("user_color", msg.user_color);
+    obj.set("message", msg.message);
+    obj.set("is_mod", msg.is_mod);
+    obj.set("is_broadcaster", msg.is_broadcaster);
+    obj.set("is_paid_member", msg.is_paid_member);
+    obj.set("timestamp", msg.timestamp);
+    obj.set("more_metadata", json::VAL_OBJECT);
+    json::value_object &metadata = (json::value_object&) obj.at("more_metadata");
+    for (auto &item : msg.more_metadata)
+        metadata.set(item.first, item.second);
+    // Compact JSON output never contains raw newlines, so it always fits in a single data line
+    std::string event = "id: " + std::to_string(id) + "\ndata: ";
+    event.append(obj.write_to_string());
+    event.append("\n\n");
+    return event;
+}
+
+void sse_server::pull_handler(sse_server *target) {
+    std::vector<message> messages = target->sub->pull();
+    // Keep getting messages until we unsubscribe
+    while (!messages.empty()) {
+        // Serialize each message once, outside of the lock
+        std::string encoded;
+        for (auto &msg : messages)
+            encoded.append(encode_message(msg, target->next_event_id++));
+        {
+            std::lock_guard<std::mutex> guard(target->pending_lock);
+            target->pending.append(encoded);
+        }
+        messages = target->sub->pull();
+    }
+}
+
+void sse_server::serve_handler(sse_server *target) {
+    auto next_flush = std::chrono::steady_clock::now() + target->frame_interval;
+    std::vector<pollfd> fds;
+    char scratch[4096];
+
+    while (target->running) {
+        // Wake-up pipe and listening socket first, followed by pending connections and clients
+        fds.clear();
+        fds.push_back({target->wake_pipe[0], POLLIN, 0});
+        fds.push_back({target->listen_fd, POLLIN, 0});
+        for (auto &conn : target->connecting)
+            fds.push_back({conn.fd, POLLIN, 0});
+        for (auto &c : target->clients)
+            fds.push_back({c.fd, (short) (c.outgoing.empty() ? POLLIN : POLLIN | POLLOUT), 0});
+
+        // Sleep until something happens or the next frame is due
+        auto now = std::chrono::steady_clock::now();
+        int timeout = 0;
+        if (next_flush > now)
+            timeout = std::chrono::duration_cast<std::chrono::milliseconds>(next_flush - now).count() + 1;
+        if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR) {
+            target->log.put(logging::ERROR, {"poll() failed: ", std::strerror(errno)});
+            break;
+        }
+
+        // Drain wake-up pipe
+        if (fds[0].revents & POLLIN)
+            while (read(target->wake_pipe[0], scratch, sizeof(scratch)) > 0);
+
+        // Read requests of pending connections (which may turn into clients, so remember the current amount)
+        size_t client_count = target->clients.size();
+        size_t fd_pos = 2;
+        for (auto &conn : target->connecting) {
+            short revents = fds[fd_pos++].revents;
+            if (!revents)
+                continue;
+            ssize_t n = read(conn.fd, scratch, sizeof(scratch));
+            if (n > 0)
+                conn.request.append(scratch, n);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR) || !target->handle_request(conn)) {
+                close(conn.fd);
+                conn.fd = -1;
+            }
+        }
+
+        // Check clients for disconnections and continue unfinished writes
+        for (size_t i=0; i<client_count; i++) {
+            client &c = target->clients[i];
+            short revents = fds[fd_pos++].revents;
+            bool alive = true;
+            if (revents & (POLLERR | POLLHUP | POLLNVAL))
+                alive = false;
+            else if (revents & POLLIN) {
+                // Clients aren't supposed to send anything else, so reading is only used to detect them closing
+                ssize_t n = read(c.fd, scratch, sizeof(scratch));
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+                    alive = false;
+            }
+            if (alive && (revents & POLLOUT))
+                alive = target->write_client(c);
+            if (!alive) {
+                close(c.fd);
+                c.fd = -1;
+            }
+        }
+
+        // Accept new connections (after the loops above, since it invalidates the poll list)
+        if (fds[1].revents & POLLIN)
+            target->accept_connections();
+
+        // Send batched events once per frame
+        now = std::chrono::steady_clock::now();
+        if (now >= next_flush) {
+            target->flush(now);
+            next_flush += target->frame_interval;
+            // Don't try to catch up on missed frames
+            if (next_flush < now)
+                next_flush = now + target->frame_interval;
+        }
+
+        // Forget closed connections
+        target->connecting.erase(std::remove_if(target->connecting.begin(), target->connecting.end(),
+                                                [](const pending_connection &conn) {return conn.fd < 0;}),
+                                 target->connecting.end());
+        target->clients.erase(std::remove_if(target->clients.begin(), target->clients.end(),
+                                             [](const client &c) {return c.fd < 0;}),
+                              target->clients.end());
+        target->connected = target->clients.size();
+    }
+}
+
+void sse_server::accept_connections() {
+    while (true) {
+        int fd = accept4(this->listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                this->log.put(logging::WARNING, {"Couldn't accept connection: ", std::strerror(errno)});
+            return;
+        }
+        this->connecting.push_back({fd, std::string()});
+    }
+}
+
+bool sse_server::handle_request(pending_connection &conn) {
+    // Wait for the full request header
+    if (conn.request.find("\r\n\r\n") == std::string::npos)
+        return conn.request.size() < max_request_size;
+    // Only GET requests for the event stream are served
+    std::string path;
+    if (conn.request.compare(0, 4, "GET ") == 0) {
+        size_t path_end = conn.request.find(' ', 4);
+        if (path_end != std::string::npos)
+            path = conn.request.substr(4, path_end - 4);
+    }
+    path = path.substr(0, path.find('?'));
+    if (path != "/" && path != "/chat") {
+        if (write(conn.fd, response_not_found, std::strlen(response_not_found)) < 0)
+            this->log.put(logging::DEBUG, {"Couldn't send response: ", std::strerror(errno)});
+        return false;
+    }
+    // Turn it into a client; the response header is sent like any other data
+    client c;
+    c.fd = conn.fd;
+    auto header = std::make_shared<const std::string>(response_ok);
+    c.outgoing.push_back(header);
+    c.backlog = header->size();
+    if (!this->write_client(c))
+        return false;
+    this->clients.push_back(std::move(c));
+    this->connected = this->clients.size();
+    // Ownership of the socket was handed over to the client
+    conn.fd = -1;
+    this->log.put(logging::DEBUG, {"Client connected"});
+    return true;
+}
+
+void sse_server::flush(std::chrono::steady_clock::time_point now) {
+    std::string frame;
+    {
+        std::lock_guard<std::mutex> guard(this->pending_lock);
+        frame.swap(this->pending);
+    }
+    // Send a comment every now and then, so dead connections get noticed
+    if (frame.empty() && now - this->last_write >= keepalive_interval)
+        frame = ":\n\n";
+    if (frame.empty())
+        return;
+    this->last_write = now;
+    if (this->clients.empty())
+        return;
+
+    // All clients share the same buffer
+    auto shared_frame = std::make_shared<const std::string>(std::move(frame));
+    for (auto &c : this->clients) {
+        if (c.fd < 0)
+            continue;
+        c.outgoing.push_back(shared_frame);
+        c.backlog += shared_frame->size();
+        bool alive = this->write_client(c);
+        if (alive && c.backlog > max_client_backlog) {
+            this->log.put(logging::WARNING, {"Dropping client that can't keep up (", (uint64_t) c.backlog, " bytes behind)"});
+            alive = false;
+        }
+        if (!alive) {
+            close(c.fd);
+            c.fd = -1;
+        }
+    }
+}
+
+bool sse_server::write_client(client &c) {
+    while (!c.outgoing.empty()) {
+        const std::string &data = *c.outgoing.front();
+        ssize_t n = send(c.fd, data.data() + c.offset, data.size() - c.offset, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            // Socket buffer is full; the rest gets written when poll() says it's writable
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        c.offset += n;
+        c.backlog -= n;
+        if (c.offset == data.size()) {
+            c.outgoing.pop_front();
+            c.offset = 0;
+        }
+    }
+    return true;
+}
+
+void sse_server::close_all() {
+    for (auto &conn : this->connecting)
+        if (conn.fd >= 0)
+            close(conn.fd);
+    this->connecting.clear();
+    for (auto &c : this->clients)
+        if (c.fd >= 0)
+            close(c.fd);
+    this->clients.clear();
+    this->connected = 0;
+    if (this->listen_fd >= 0)
+        close(this->listen_fd);
+    this->listen_fd = -1;
+    for (int &fd : this->wake_pipe) {
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+    }
+}
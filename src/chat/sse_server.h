@@ -0,0 +1,91 @@
+#ifndef STRTB_CHAT_SSE_SERVER_H
+#define STRTB_CHAT_SSE_SERVER_H
+
+#include "system.h"
+#include "subscription.h"
+#include "../logging/logging.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace strtb::config {
+class system;
+}
+
+namespace strtb::chat {
+
+struct sse_config {
+    bool enabled = true;
+    uint16_t port = 8787;
+};
+
+/* Reads server options from a config category. All keys are optional:
+ *   <prefix>enabled  whether chat events are served at all (true by default)
+ *   <prefix>port     port to listen on at 127.0.0.1 (8787 by default, 0 = any free port)
+ */
+sse_config read_sse_config(config::system &config, const std::string &category, const std::string &prefix);
+
+/* Loopback HTTP endpoint that streams chat as Server-Sent Events (e.g. for browser overlays).
+ * Every message is serialized to JSON exactly once; the encoded events of each frame interval
+ * are batched into one shared buffer, which is then written to all connected clients.
+ */
+class sse_server {
+private:
+    struct pending_connection {
+        int fd;
+        std::string request;
+    };
+    struct client {
+        int fd;
+        std::deque<std::shared_ptr<const std::string>> outgoing;
+        size_t offset = 0;      // Bytes of outgoing.front() that were already sent
+        size_t backlog = 0;     // Total bytes waiting in outgoing
+    };
+
+    logging::source log;
+    class system *chat;
+    subscription *sub = nullptr;
+    int listen_fd = -1;
+    int wake_pipe[2] = {-1, -1};
+    uint16_t port;
+    std::chrono::milliseconds frame_interval;
+    std::thread *pull_thread = nullptr;
+    std::thread *serve_thread = nullptr;
+    std::atomic<bool> running = false;
+    std::atomic<size_t> connected = 0;
+    // Encoded events waiting for the next flush
+    std::mutex pending_lock;
+    std::string pending;
+    unsigned long long next_event_id = 0;
+    // Only touched by the serving thread
+    std::vector<pending_connection> connecting;
+    std::vector<client> clients;
+    std::chrono::steady_clock::time_point last_write;
+
+    static void pull_handler(sse_server *target);
+    static void serve_handler(sse_server *target);
+    static std::string encode_message(const message &msg, unsigned long long id);
+    void accept_connections();
+    bool handle_request(pending_connection &conn);
+    void flush(std::chrono::steady_clock::time_point now);
+    bool write_client(client &c);
+    void close_all();
+public:
+    static constexpr size_t max_client_backlog = 4 * 1024 * 1024;
+    static constexpr std::chrono::seconds keepalive_interval{15};
+
+    sse_server(class system *chat, uint16_t port = 8787, std::chrono::milliseconds frame_interval = std::chrono::milliseconds(16));
+    ~sse_server();
+    uint16_t get_port();
+    size_t client_count();
+};
+
+}
+
+#endif // STRTB_CHAT_SSE_SERVER_H
@@ -32,9 +32,25 @@ std::vector<message> subscription::pull() {
     return response;
 }
 
+void subscription::set_max_age(std::chrono::milliseconds max_age) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    // The queue only exists while subscribed
+    if (this->subscribed)
+        this->queue->set_max_age(max_age);
+}
+
+uint64_t subscription::get_expired_count() {
+    std::lock_guard<std::mutex> guard(this->lock);
+    if (this->subscribed)
+        this->expired = this->queue->get_expired_count();
+    return this->expired;
+}
+
 void subscription::unsubscribe() {
     std::lock_guard guard(this->lock);
     // Mark as unsubscribed and deregister from chat system (unless abandoned)
+    if (this->subscribed)
+        this->expired = this->queue->get_expired_count();
     this->subscribed = false;
     if (this->deregister)
         this->deregister->deregister(this);
@@ -44,6 +60,8 @@ void subscription::abandon() {
     this->log.put(logging::WARNING, {"Abandoned by parent"});
     std::lock_guard guard(this->lock);
     // Our parent has abandoned us, so we shouldn't do any more actions that communicate with the parent
+    if (this->subscribed)
+        this->expired = this->queue->get_expired_count();
     this->subscribed = false;
     this->deregister = nullptr;
 }
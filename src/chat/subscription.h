@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <chrono>
+#include <cstdint>
 #include "queue.h"
 #include "../common/deregistration_interface.h"
 #include "../logging/logging.h"
@@ -16,6 +18,7 @@ private:
     std::string provider_id, channel_id;
     class queue *queue;
     bool subscribed = true;
+    uint64_t expired = 0;   // Last known expired count, kept after the queue is gone
     std::mutex lock;
     common::deregistration_interface<subscription*> *deregister;
 protected:
@@ -28,6 +31,8 @@ public:
     std::string get_provider_id();
     std::string get_channel_id();
     std::vector<message> pull();
+    void set_max_age(std::chrono::milliseconds max_age);
+    uint64_t get_expired_count();
     void unsubscribe();
 };
 
@@ -1,4 +1,5 @@
 #include "system.h"
+#include <algorithm>
 #include <thread>
 #include <vector>
 
@@ -7,7 +8,17 @@ using namespace strtb::chat;
 
 chat::system *chat::main = nullptr;
 
-system::system() : log("Chat System") {
+// Subscription key for any provider or any channel
+static const std::string empty_id;
+
+template<class duration>
+static void add_age(snapshot_queue &queue, duration extra) {
+    auto extra_ms = std::chrono::duration_cast<std::chrono::milliseconds>(extra);
+    for (auto &item : queue.messages)
+        item.age += extra_ms;
+}
+
+system::system() : log("Chat System"), routes(new route_table) {
     // Start incoming message thread
     this->incoming = new queue();
     this->incoming->block_deletion();
@@ -16,76 +27,201 @@ system::system() : log("Chat System") {
 
 void system::incoming_handler(system *target) {
     std::vector<message> messages;
+    target->incoming_thread_id = current_thread_id();
     // Keep getting messages until the queue is deleted
-    do {
-        // Wait for messages
-        messages = target->incoming->pull();
-        // Relay messages to subscribers
-        std::lock_guard<std::mutex> guard(target->subscription_lock);
-        for (auto &msg : messages) {
-            {
-                // Find wanted provider
-                auto provider = target->subscriptions.find(msg.provider_id);
-                if (provider != target->subscriptions.end()) {
-                    {
-                        // Find wanted channel
-                        auto channel = provider->second->find(msg.channel_id);
-                        if (channel != provider->second->end()) {
-                            for (auto sub : *channel->second) {
-                                // Push to all subscribers of this channel
-                                sub.second->push(msg);
-                            }
-                        }
-                    }
-                    {
-                        // Also push to channel-agnostic subscribers
-                        auto channel_all = provider->second->find("");
-                        if (channel_all != provider->second->end()) {
-                            for (auto sub : *channel_all->second) {
-                                // Push to all channel-agnostic subscribers of this provider
-                                sub.second->push(msg);
-                            }
-                        }
-                    }
-                }
-            }
-            {
-                // Also push to provider-agnostic subscribers
-                auto provider_all = target->subscriptions.find("");
-                if (provider_all != target->subscriptions.end()) {
-                    {
-                        // Find wanted channel
-                        auto channel = provider_all->second->find(msg.channel_id);
-                        if (channel != provider_all->second->end()) {
-                            for (auto sub : *channel->second) {
-                                // Push to all subscribers of this channel
-                                sub.second->push(msg);
-                            }
-                        }
-                    }
-                    {
-                        // Also push to channel-agnostic subscribers
-                        auto channel_all = provider_all->second->find("");
-                        if (channel_all != provider_all->second->end()) {
-                            for (auto sub : *channel_all->second) {
-                                // Push to all channel-agnostic subscribers of this provider
-                                sub.second->push(msg);
-                            }
-                        }
-                    }
-                }
+    while (true) {
+        // Free retired routing tables and queues while there's nothing to dispatch
+        if (target->reclaim_pending && target->incoming->empty())
+            target->reclaim_idle();
+        std::chrono::milliseconds window(target->merge_window_ms);
+        if (window.count() == 0 && target->merger.empty()) {
+            // Relay messages in the order they arrived
+            messages = target->incoming->pull();
+            if (messages.empty())
+                break;
+            target->record_dispatch_latency();
+            window = std::chrono::milliseconds(target->merge_window_ms);
+            if (window.count() == 0) {
+                target->dispatch(messages);
+                continue;
             }
+            // Merging was turned on while we were waiting, so these are the first messages to hold
+        } else {
+            // Hold messages in the merger until they can be released in timestamp order
+            if (target->merger.empty())
+                messages = target->incoming->pull();
+            else
+                messages = target->incoming->pull_until(target->merger.next_release(window));
+            if (messages.empty() && target->incoming->is_deleting())
+                break;
+            if (!messages.empty())
+                target->record_dispatch_latency();
         }
-    } while (!messages.empty());
+        target->merger.add(messages);
+        // Release everything if merging was turned off
+        messages = target->merger.take_ready(window, window.count() == 0);
+        if (!messages.empty())
+            target->dispatch(messages);
+    }
+    // Don't lose messages that were still being held
+    if (!target->merger.empty()) {
+        messages = target->merger.take_ready(std::chrono::milliseconds(0), true);
+        target->dispatch(messages);
+    }
     // Allow the queue to be deleted when we finish
     target->incoming->allow_deletion();
 }
 
+void system::record_dispatch_latency() {
+    // Scheduling latency of this thread: only pulls that parked count, since otherwise there was no wakeup to wait for
+    auto delay = this->incoming->get_last_wakeup_delay();
+    if (delay != std::chrono::steady_clock::duration::zero())
+        this->dispatch_latency.add(delay);
+}
+
+void system::dispatch(std::vector<message> &messages) {
+    // Run optional stages (the ones that annotate messages go first)
+    if (class flood_detector *flood_detector = this->flood_detector)
+        flood_detector->process(messages);
+    this->run_middleware(messages);
+    if (class analytics *analytics = this->analytics)
+        analytics->process(messages);
+    if (class search_index *search_index = this->search_index)
+        search_index->process(messages);
+    if (messages.empty())
+        return;
+    // Enter the current epoch before reading the routing table, so nothing we use gets freed under us
+    this->dispatch_epoch = this->epoch.load();
+    const route_table *routes = this->routes;
+    // Relay messages to subscribers
+    for (auto &msg : messages) {
+        // Subscribers of this provider, and provider-agnostic subscribers
+        for (const std::string *provider_id : {(const std::string*) &msg.provider_id, &empty_id}) {
+            auto provider = routes->find(*provider_id);
+            if (provider == routes->end())
+                continue;
+            // Subscribers of this channel, and channel-agnostic subscribers
+            for (const std::string *channel_id : {(const std::string*) &msg.channel_id, &empty_id}) {
+                auto channel = provider->second.find(*channel_id);
+                if (channel == provider->second.end())
+                    continue;
+                for (queue *queue : channel->second)
+                    queue->push(msg);
+            }
+        }
+    }
+    // Leave the epoch
+    this->dispatch_epoch = 0;
+}
+
+void system::publish_routes(queue *removed) {
+    // Called with subscription_lock held. Builds a new routing table from the subscription map and swaps it in.
+    route_table *routes = new route_table;
+    for (auto &sub_pr_itr : this->subscriptions)
+        for (auto &sub_ch_itr : *sub_pr_itr.second) {
+            std::vector<queue*> &queues = (*routes)[sub_pr_itr.first][sub_ch_itr.first];
+            queues.reserve(sub_ch_itr.second->size());
+            for (auto &sub_in_itr : *sub_ch_itr.second)
+                queues.push_back(sub_in_itr.second);
+        }
+    const route_table *old_routes = this->routes.exchange(routes);
+    // The dispatcher might still be using the old table (and the removed queue), so retire them until it's safe
+    this->retired.push_back({this->epoch.fetch_add(1), old_routes, removed});
+    this->retired_count++;
+    this->reclaim_pending = true;
+}
+
+std::vector<system::retired_item> system::take_reclaimable() {
+    // Called with subscription_lock held. Anything retired before the epoch the dispatcher is in (or everything,
+    // if it's idle) can't be seen by it anymore, since it read the routing table after entering that epoch.
+    std::vector<retired_item> reclaimable;
+    uint64_t active = this->dispatch_epoch;
+    auto itr = this->retired.begin();
+    while (itr != this->retired.end() && (active == 0 || itr->epoch < active))
+        reclaimable.push_back(*itr++);
+    this->retired.erase(this->retired.begin(), itr);
+    this->reclaim_pending = !this->retired.empty();
+    return reclaimable;
+}
+
+void system::free_retired(std::vector<retired_item> &items) {
+    // Done without holding subscription_lock, since deleting a queue waits for its subscriber to stop pulling from it
+    for (auto &item : items) {
+        // The epoch only moves forward, so this can't happen unless take_reclaimable() let something go too early
+        uint64_t active = this->dispatch_epoch;
+        if (active != 0 && item.epoch >= active)
+            this->freed_in_use_count++;
+        delete item.routes;
+        delete item.queue;
+    }
+    this->freed_count += items.size();
+    items.clear();
+}
+
+void system::reclaim_idle() {
+    // Called by the dispatcher between batches, outside of any epoch. Without this, whatever was retired while it was
+    // dispatching would stay allocated until the next subscription change.
+    std::vector<retired_item> reclaimable;
+    {
+        std::lock_guard<std::mutex> guard(this->subscription_lock);
+        reclaimable = this->take_reclaimable();
+    }
+    this->free_retired(reclaimable);
+}
+
+void system::run_middleware(std::vector<message> &messages) {
+    std::lock_guard<std::mutex> guard(this->middleware_lock);
+    for (auto &entry : this->middleware_chain) {
+        if (messages.empty())
+            break;
+        if (entry.stats.failed)
+            continue;
+        auto start = std::chrono::steady_clock::now();
+        // Let the stage process each message, and drop the ones it rejects (keeping the order)
+        size_t kept = 0;
+        size_t i = 0;
+        try {
+            for (; i<messages.size(); i++) {
+                if (entry.stage->process(messages[i])) {
+                    if (kept != i)
+                        messages[kept] = std::move(messages[i]);
+                    kept++;
+                }
+            }
+        } catch (std::exception &e) {
+            this->log.put(logging::ERROR, {"Middleware ", entry.stats.name, " failed, skipping it from now on: ", e.what()});
+            entry.stats.failed = true;
+        } catch (...) {
+            this->log.put(logging::ERROR, {"Middleware ", entry.stats.name, " failed, skipping it from now on"});
+            entry.stats.failed = true;
+        }
+        // Messages the stage didn't get to (including the one it failed on) are passed on as they are
+        for (; i<messages.size(); i++) {
+            if (kept != i)
+                messages[kept] = std::move(messages[i]);
+            kept++;
+        }
+        size_t dropped = messages.size() - kept;
+        entry.stats.messages += messages.size();
+        messages.resize(kept);
+        // Timing stats
+        double time_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        entry.stats.batches++;
+        entry.stats.dropped += dropped;
+        entry.stats.total_time_us += time_us;
+        if (time_us > entry.stats.max_batch_time_us)
+            entry.stats.max_batch_time_us = time_us;
+    }
+}
+
 system::~system() {
     // Stop queue and wait for it to be deleted
     delete this->incoming;
     this->incoming_thread->join();
     delete this->incoming_thread;
+    delete this->analytics.load();
+    delete this->flood_detector.load();
+    delete this->search_index.load();
 
     // Check for providers that will be abandoned
     {
@@ -96,6 +232,7 @@ system::~system() {
     }
 
     // Delete subscription maps and check for subscriptions that will be abandoned
+    std::vector<retired_item> retired;
     {
         std::lock_guard<std::mutex> guard(this->subscription_lock);
         for (auto sub_pr_itr : this->subscriptions) {
@@ -110,21 +247,25 @@ system::~system() {
             }
             delete sub_pr_itr.second;
         }
+        // The dispatcher has stopped, so everything that was retired can be freed now
+        retired.swap(this->retired);
     }
+    free_retired(retired);
+    delete this->routes.load();
 }
 
-system_channel_info system::get_channel_info() {
-    system_channel_info info;
-    info.provider_count = this->providers.size();
-    info.channel_count = 0;
-    // Get info from all providers
-    for (auto p_itr : this->providers) {
-        provider_info p_info = p_itr.second->get_info();
-        info.providers.push_back(p_info);
-        // Also count total amount of channels
-        info.channel_count += p_info.channel_count;
-    }
-    return info;
+system_channel_info system::get_channel_info(uint64_t *version) {
+    // Served from the topology mirror, so providers don't need to be walked (or locked)
+    return this->topology.get_snapshot(version);
+}
+
+uint64_t system::get_topology_version() {
+    return this->topology.get_version();
+}
+
+bool system::get_topology_changes(uint64_t since, std::vector<topology_change> &changes) {
+    // Returns false if changes since then are no longer kept, in which case get_channel_info() is needed
+    return this->topology.get_changes(since, changes);
 }
 
 provider* system::register_provider(std::string id, std::string name) {
@@ -141,8 +282,9 @@ provider* system::register_provider(std::string id, std::string name) {
         throw std::runtime_error("Provider already exists");
     }
     // Register new provider and return it
-    provider* provider = new class provider(id, name, this->incoming, this);
+    provider* provider = new class provider(id, name, this->incoming, this, &this->topology);
     this->providers[id] = provider;
+    this->topology.provider_added(id, name);
     return provider;
 }
 
@@ -154,11 +296,13 @@ void system::deregister(provider* object) {
     // Make sure the provider was actually registered
     if (itr == this->providers.end())
         this->log.put(logging::WARNING, {"Deregistering a provider that wasn't registered: ", id});
-    else
+    else {
         this->providers.erase(itr);
+        this->topology.provider_removed(id);
+    }
 }
 
-subscription* system::subscribe(std::string provider_id, std::string channel_id) {
+subscription* system::subscribe(std::string provider_id, std::string channel_id, std::chrono::milliseconds max_age) {
     // Friendlier message when subscribing to any provider or any channel (which are empty ID strings)
     std::string provider_id_log = provider_id.empty() ? "(any)" : provider_id;
     std::string channel_id_log = channel_id.empty() ? "(any)" : channel_id;
@@ -168,27 +312,46 @@ subscription* system::subscribe(std::string provider_id, std::string channel_id)
     sub_map_sublist *new_channel = nullptr;
     queue *queue = nullptr;
     subscription *sub = nullptr;
+    std::vector<retired_item> reclaimable;
     try {
-        std::lock_guard<std::mutex> guard(this->subscription_lock);
-        // Make sure provider exists in subscription map
-        auto provider = this->subscriptions.emplace(provider_id, nullptr);
-        if (provider.second) {
-            // Create it if it doesn't
-            new_provider = new sub_map_channels;
-            provider.first->second = new_provider;
-        }
-        // Make sure channel exists in subscription map
-        auto channel = provider.first->second->emplace(channel_id, nullptr);
-        if (channel.second) {
-            // Create it if it doesn't
-            new_channel = new sub_map_sublist;
-            channel.first->second = new_channel;
+        {
+            std::lock_guard<std::mutex> guard(this->subscription_lock);
+            // Make sure provider exists in subscription map
+            auto provider = this->subscriptions.emplace(provider_id, nullptr);
+            if (provider.second) {
+                // Create it if it doesn't
+                new_provider = new sub_map_channels;
+                provider.first->second = new_provider;
+            }
+            // Make sure channel exists in subscription map
+            auto channel = provider.first->second->emplace(channel_id, nullptr);
+            if (channel.second) {
+                // Create it if it doesn't
+                new_channel = new sub_map_sublist;
+                channel.first->second = new_channel;
+            }
+            // Create channel and its message queue
+            queue = new class queue();
+            queue->set_max_age(max_age);
+            // Pick up where a matching subscription left off before a restart, if there was one
+            auto parked = this->parked_queues.find(std::make_pair(provider_id, channel_id));
+            if (parked != this->parked_queues.end()) {
+                this->log.put(logging::INFO, {"Restoring ", (int64_t) parked->second.messages.size(), " pending messages for ",
+                                              provider_id_log, ":", channel_id_log});
+                if (max_age.count() == 0)
+                    queue->set_max_age(parked->second.max_age);
+                add_age(parked->second, std::chrono::steady_clock::now() - this->parked_at);
+                queue->push_aged(std::move(parked->second.messages));
+                this->parked_queues.erase(parked);
+            }
+            sub = new subscription(provider_id, channel_id, queue, this);
+            // Put the sub in the submap, and let the dispatcher see it
+            channel.first->second->emplace(sub, queue);
+            this->publish_routes(nullptr);
+            reclaimable = this->take_reclaimable();
         }
-        // Create channel and its message queue
-        queue = new class queue();
-        sub = new subscription(provider_id, channel_id, queue, this);
-        // Put the sub in the submap
-        channel.first->second->emplace(sub, queue);
+        // Free what was retired by earlier changes, now that the lock is released
+        free_retired(reclaimable);
         return sub;
     } catch (std::exception& e) {
         // On exceptions, delete any new objects (to avoid memory leaks) and pass on the exception
@@ -212,7 +375,16 @@ void system::deregister(subscription* object) {
     std::string provider_id_log = provider_id.empty() ? "(any)" : provider_id;
     std::string channel_id_log = channel_id.empty() ? "(any)" : channel_id;
     this->log.put(logging::DEBUG, {"Unsubscribing from ", provider_id_log, ":", channel_id_log});
-    std::lock_guard<std::mutex> guard(this->subscription_lock);
+    std::vector<retired_item> reclaimable;
+    {
+        std::lock_guard<std::mutex> guard(this->subscription_lock);
+        this->deregister_locked(object, provider_id, channel_id);
+        reclaimable = this->take_reclaimable();
+    }
+    free_retired(reclaimable);
+}
+
+void system::deregister_locked(subscription* object, const std::string &provider_id, const std::string &channel_id) {
     // Make sure subscription actually exists
     auto provider = this->subscriptions.find(provider_id);
     if (provider != this->subscriptions.end()) {
@@ -220,8 +392,10 @@ void system::deregister(subscription* object) {
         if (channel != provider->second->end()) {
             auto sub_instance = channel->second->find(object);
             if (sub_instance != channel->second->end()) {
-                // Everything exists, and we can deregister the subscription properly and delete its queue
-                delete sub_instance->second;
+                // Everything exists, and we can deregister the subscription properly.
+                // Its queue is closed right away (waking up its subscriber), and freed once the dispatcher is done with it.
+                class queue *queue = sub_instance->second;
+                queue->close();
                 channel->second->erase(sub_instance);
                 // Also delete any map branches that are now empty
                 if (channel->second->size() == 0) {
@@ -232,10 +406,177 @@ void system::deregister(subscription* object) {
                     delete provider->second;
                     this->subscriptions.erase(provider);
                 }
+                this->publish_routes(queue);
                 return;
             }
         }
     }
     // Something in the map structure doesn't exist
-    this->log.put(logging::WARNING, {"Deregistering subscription that isn't registered: ", provider_id_log, ":", channel_id_log, "@", object});
+    this->log.put(logging::WARNING, {"Deregistering subscription that isn't registered: ", provider_id.empty() ? "(any)" : provider_id, ":",
+                                     channel_id.empty() ? "(any)" : channel_id, "@", object});
+}
+
+analytics* system::enable_analytics() {
+    std::lock_guard<std::mutex> guard(this->stage_lock);
+    if (!this->analytics) {
+        this->log.put(logging::DEBUG, {"Enabling chat analytics"});
+        this->analytics = new class analytics();
+    }
+    return this->analytics;
+}
+
+analytics* system::get_analytics() {
+    return this->analytics;
+}
+
+flood_detector* system::enable_flood_detector(const flood_detector_config &config) {
+    std::lock_guard<std::mutex> guard(this->stage_lock);
+    if (this->flood_detector) {
+        this->flood_detector.load()->set_config(config);
+    } else {
+        this->log.put(logging::DEBUG, {"Enabling flood detector"});
+        this->flood_detector = new class flood_detector(config);
+    }
+    return this->flood_detector;
+}
+
+flood_detector* system::get_flood_detector() {
+    return this->flood_detector;
+}
+
+search_index* system::enable_search_index(const search_index_config &config) {
+    std::lock_guard<std::mutex> guard(this->stage_lock);
+    if (this->search_index) {
+        this->search_index.load()->set_config(config);
+    } else {
+        this->log.put(logging::DEBUG, {"Enabling chat search index"});
+        this->search_index = new class search_index(config);
+    }
+    return this->search_index;
+}
+
+search_index* system::get_search_index() {
+    return this->search_index;
+}
+
+void system::set_merge_window(std::chrono::milliseconds window) {
+    this->log.put(logging::DEBUG, {"Setting merge window to ", (int64_t) window.count(), " ms"});
+    this->merge_window_ms = window.count();
+}
+
+std::chrono::milliseconds system::get_merge_window() {
+    return std::chrono::milliseconds(this->merge_window_ms);
+}
+
+merge_stats system::get_merge_stats() {
+    return this->merger.get_stats();
+}
+
+void system::add_middleware(middleware *stage, const std::string &name, int order) {
+    this->log.put(logging::DEBUG, {"Adding middleware ", name, " at order ", order});
+    if (!stage)
+        throw std::invalid_argument("Middleware can't be null");
+    std::lock_guard<std::mutex> guard(this->middleware_lock);
+    for (auto &entry : this->middleware_chain) {
+        if (entry.stage == stage) {
+            this->log.put(logging::ERROR, {"Middleware ", name, " was already added"});
+            throw std::runtime_error("Middleware was already added");
+        }
+    }
+    // Keep the chain sorted by order; stages with the same order run in the order they were added
+    auto pos = this->middleware_chain.begin();
+    while (pos != this->middleware_chain.end() && pos->stats.order <= order)
+        pos++;
+    this->middleware_chain.insert(pos, {stage, {name, order, 0, 0, 0, 0, 0, false}});
+}
+
+void system::remove_middleware(middleware *stage) {
+    // Once this returns, the dispatcher won't use the stage anymore
+    std::lock_guard<std::mutex> guard(this->middleware_lock);
+    for (auto itr = this->middleware_chain.begin(); itr != this->middleware_chain.end(); itr++) {
+        if (itr->stage == stage) {
+            this->log.put(logging::DEBUG, {"Removing middleware ", itr->stats.name});
+            this->middleware_chain.erase(itr);
+            return;
+        }
+    }
+    this->log.put(logging::WARNING, {"Removing middleware that wasn't added: ", (void*) stage});
+}
+
+std::vector<middleware_stats> system::get_middleware_stats() {
+    std::lock_guard<std::mutex> guard(this->middleware_lock);
+    std::vector<middleware_stats> stats;
+    stats.reserve(this->middleware_chain.size());
+    for (auto &entry : this->middleware_chain)
+        stats.push_back(entry.stats);
+    return stats;
+}
+
+void system::set_dispatcher_scheduling(const scheduling_config &config) {
+    this->log.put(logging::DEBUG, {"Setting dispatcher scheduling: ", (int64_t) config.cpus.size(), " CPUs, policy ",
+                                   config.policy.empty() ? "(unchanged)" : config.policy});
+    // The thread reports its ID as soon as it starts
+    while (!this->incoming_thread_id)
+        std::this_thread::yield();
+    try {
+        apply_scheduling(this->incoming_thread->native_handle(), this->incoming_thread_id, config);
+    } catch (std::exception &e) {
+        this->log.put(logging::ERROR, {"Couldn't set dispatcher scheduling: ", e.what()});
+        throw;
+    }
+}
+
+routing_stats system::get_routing_stats() {
+    std::lock_guard<std::mutex> guard(this->subscription_lock);
+    return {this->retired_count, this->freed_count, this->freed_in_use_count};
+}
+
+latency_stats system::get_dispatch_latency() {
+    return this->dispatch_latency.get_stats();
+}
+
+void system::reset_dispatch_latency() {
+    this->dispatch_latency.reset();
+}
+
+void system::save_snapshot(const std::filesystem::path &path) {
+    this->log.put(logging::DEBUG, {"Saving snapshot to ", path});
+    snapshot snapshot;
+    snapshot.saved_at = std::chrono::system_clock::now();
+    snapshot.providers = this->topology.get_snapshot().providers;
+    {
+        std::lock_guard<std::mutex> guard(this->subscription_lock);
+        for (auto &sub_pr_itr : this->subscriptions)
+            for (auto &sub_ch_itr : *sub_pr_itr.second)
+                for (auto &sub_in_itr : *sub_ch_itr.second)
+                    snapshot.queues.push_back({sub_pr_itr.first, sub_ch_itr.first, sub_in_itr.second->get_max_age(),
+                                               sub_in_itr.second->copy_all()});
+        // Restored queues that weren't claimed yet are kept for the next restart
+        auto parked_for = std::chrono::steady_clock::now() - this->parked_at;
+        for (auto &parked : this->parked_queues) {
+            snapshot.queues.push_back(parked.second);
+            add_age(snapshot.queues.back(), parked_for);
+        }
+    }
+    snapshot.write_to_file(path);
+}
+
+void system::restore_snapshot(const std::filesystem::path &path) {
+    this->log.put(logging::DEBUG, {"Restoring snapshot from ", path});
+    snapshot snapshot = snapshot::read_from_file(path);
+    int channel_count = 0;
+    for (auto &provider : snapshot.providers)
+        channel_count += provider.channel_count;
+    // Providers and channels register themselves again when their plugins load, so they're only reported here
+    this->log.put(logging::INFO, {"Snapshot had ", (int64_t) snapshot.providers.size(), " providers with ", channel_count,
+                                  " channels, and ", (int64_t) snapshot.queues.size(), " subscription queues"});
+    // Messages kept aging while the program wasn't running
+    auto downtime = std::max(std::chrono::system_clock::now() - snapshot.saved_at, std::chrono::system_clock::duration::zero());
+    std::lock_guard<std::mutex> guard(this->subscription_lock);
+    this->parked_at = std::chrono::steady_clock::now();
+    for (auto &queue : snapshot.queues) {
+        add_age(queue, downtime);
+        auto key = std::make_pair(queue.provider_id, queue.channel_id);
+        this->parked_queues.emplace(key, std::move(queue));
+    }
 }
@@ -4,17 +4,27 @@
 #include "queue.h"
 #include "provider.h"
 #include "subscription.h"
+#include "analytics.h"
+#include "flood_detector.h"
+#include "search_index.h"
+#include "timestamp_merger.h"
+#include "middleware.h"
+#include "topology.h"
+#include "snapshot.h"
+#include "scheduling.h"
 #include "../common/deregistration_interface.h"
 #include "../logging/logging.h"
 #include <map>
 #include <thread>
+#include <atomic>
+#include <chrono>
 
 namespace strtb::chat {
 
-struct system_channel_info {
-    int provider_count;
-    int channel_count;
-    std::vector<provider_info> providers;
+struct routing_stats {
+    uint64_t retired;       // Routing tables and removed queues that were replaced while the dispatcher could use them
+    uint64_t freed;         // How many of them were freed so far
+    uint64_t freed_in_use;  // Freed while the dispatcher's epoch still covered them (a reclamation bug if not 0)
 };
 
 class system : common::deregistration_interface<provider*>, common::deregistration_interface<subscription*> {
@@ -28,20 +38,87 @@ private:
     queue *incoming;
     std::thread *incoming_thread;
     std::map<std::string, provider*> providers;
+    class topology topology;
     static void incoming_handler(system *target);
+    std::atomic<long> incoming_thread_id = 0;
+    latency_histogram dispatch_latency;     // From a push waking up the parked dispatcher to the dispatcher running again
+    void record_dispatch_latency();
+    void dispatch(std::vector<message> &messages);
     std::mutex provider_lock, subscription_lock;
     // map [provider_id] [channel_id] [ptr to sub] = sub's queue
     // provider_id == "" or channel_id == "" means subscribed to all providers/channels
-    // ptr to sub is only used when deregistering a sub, otherwise the inner-most map is fully iterated through
+    // Only used by subscribe/unsubscribe (under subscription_lock), the dispatcher uses the route table below
     sub_map_providers subscriptions;
+    // Copy-on-write routing table [provider_id] [channel_id] = queues, rebuilt and republished on every (un)subscription,
+    // so the dispatcher never takes a lock. Replaced tables and removed queues are retired with the epoch they were
+    // retired at, and only freed once the dispatcher is idle or has moved past that epoch.
+    typedef std::map<std::string, std::map<std::string, std::vector<queue*>>> route_table;
+    struct retired_item {
+        uint64_t epoch;
+        const route_table *routes;
+        class queue *queue;
+    };
+    std::atomic<const route_table*> routes;
+    std::atomic<uint64_t> epoch = 1;
+    std::atomic<uint64_t> dispatch_epoch = 0;  // Epoch the dispatcher entered (0 when not dispatching)
+    std::vector<retired_item> retired;
+    std::atomic<bool> reclaim_pending = false;  // Something is retired, so the dispatcher should reclaim when idle
+    uint64_t retired_count = 0;                 // Under subscription_lock
+    std::atomic<uint64_t> freed_count = 0, freed_in_use_count = 0;
+    void publish_routes(queue *removed);
+    std::vector<retired_item> take_reclaimable();
+    void free_retired(std::vector<retired_item> &items);
+    void reclaim_idle();
+    void deregister_locked(subscription* object, const std::string &provider_id, const std::string &channel_id);
+    // Queues restored from a snapshot, waiting to be claimed by the first matching subscription (under subscription_lock)
+    std::multimap<std::pair<std::string, std::string>, snapshot_queue> parked_queues;
+    std::chrono::steady_clock::time_point parked_at;    // When they were restored, since they keep aging while parked
+    // Optional stages that look at every incoming message
+    std::mutex stage_lock;
+    std::atomic<class analytics*> analytics = nullptr;
+    std::atomic<class flood_detector*> flood_detector = nullptr;
+    std::atomic<class search_index*> search_index = nullptr;
+    // Ordered chain of middleware stages
+    struct middleware_entry {
+        middleware *stage;
+        middleware_stats stats;
+    };
+    std::mutex middleware_lock;
+    std::vector<middleware_entry> middleware_chain;
+    void run_middleware(std::vector<message> &messages);
+    // Optional reordering of messages by timestamp (0 = off)
+    std::atomic<long long> merge_window_ms = 0;
+    timestamp_merger merger;
 public:
     system();
     virtual ~system();
-    system_channel_info get_channel_info();
+    // Optionally gives the topology version the info is from, for following changes with get_topology_changes()
+    system_channel_info get_channel_info(uint64_t *version = nullptr);
+    uint64_t get_topology_version();
+    bool get_topology_changes(uint64_t since, std::vector<topology_change> &changes);
     provider* register_provider(std::string id, std::string name);
-    subscription* subscribe(std::string provider_id, std::string channel_id);
+    subscription* subscribe(std::string provider_id, std::string channel_id,
+                            std::chrono::milliseconds max_age = std::chrono::milliseconds(0));
     void deregister(provider* object);
     void deregister(subscription* object);
+    class analytics* enable_analytics();
+    class analytics* get_analytics();
+    class flood_detector* enable_flood_detector(const flood_detector_config &config = flood_detector_config());
+    class flood_detector* get_flood_detector();
+    class search_index* enable_search_index(const search_index_config &config = search_index_config());
+    class search_index* get_search_index();
+    void set_merge_window(std::chrono::milliseconds window);
+    std::chrono::milliseconds get_merge_window();
+    merge_stats get_merge_stats();
+    void add_middleware(middleware *stage, const std::string &name, int order = 0);
+    void remove_middleware(middleware *stage);
+    std::vector<middleware_stats> get_middleware_stats();
+    void set_dispatcher_scheduling(const scheduling_config &config);
+    routing_stats get_routing_stats();
+    latency_stats get_dispatch_latency();
+    void reset_dispatch_latency();
+    void save_snapshot(const std::filesystem::path &path);
+    void restore_snapshot(const std::filesystem::path &path);
 };
 
 extern system *main;
@@ -0,0 +1,124 @@
+#include "timestamp_merger.h"
+
+#include <algorithm>
+
+using namespace strtb;
+using namespace strtb::chat;
+
+static long long wall_clock_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void timestamp_merger::add(std::vector<message> &messages) {
+    auto now = clock::now();
+    uint64_t late = 0;
+    for (auto &msg : messages) {
+        // Nothing to order by, or too late to be put in order
+        if (msg.timestamp == 0 || msg.timestamp < this->last_released) {
+            if (msg.timestamp != 0)
+                late++;
+            this->immediate.push_back(std::move(msg));
+            continue;
+        }
+        // Keep each provider's run sorted; messages of one provider are usually in order already
+        std::deque<entry> &run = this->runs[msg.provider_id];
+        auto pos = run.end();
+        while (pos != run.begin() && std::prev(pos)->msg.timestamp > msg.timestamp)
+            pos--;
+        run.insert(pos, {std::move(msg), now});
+        this->held++;
+    }
+    std::lock_guard<std::mutex> guard(this->stats_lock);
+    this->late_messages += late;
+}
+
+std::vector<message> timestamp_merger::take_ready(std::chrono::milliseconds window, bool everything) {
+    auto now = clock::now();
+    std::vector<message> ready = std::move(this->immediate);
+    this->immediate.clear();
+    size_t passed_through = ready.size();
+    double delay_sum = 0, delay_max = 0;
+
+    // Messages older than the watermark can't be preceded by anything that's still on its way.
+    // Runs whose first message waited for the whole window force out everything up to that message too.
+    long long now_ms = wall_clock_ms();
+    long long release_until = now_ms - window.count();
+    auto by_timestamp = [](const std::deque<entry> *a, const std::deque<entry> *b) {
+        return a->front().msg.timestamp > b->front().msg.timestamp;
+    };
+    std::vector<std::deque<entry>*> heap;
+    heap.reserve(this->runs.size());
+    for (auto &run : this->runs) {
+        if (run.second.empty())
+            continue;
+        heap.push_back(&run.second);
+        if (now - run.second.front().arrival >= window)
+            release_until = std::max(release_until, run.second.front().msg.timestamp);
+    }
+    std::make_heap(heap.begin(), heap.end(), by_timestamp);
+
+    // K-way merge of the runs
+    while (!heap.empty()) {
+        std::deque<entry> *run = heap.front();
+        entry &first = run->front();
+        if (!everything && first.msg.timestamp > release_until)
+            break;
+        std::pop_heap(heap.begin(), heap.end(), by_timestamp);
+        heap.pop_back();
+        double delay = std::chrono::duration<double, std::milli>(now - first.arrival).count();
+        delay_sum += delay;
+        delay_max = std::max(delay_max, delay);
+        // Timestamps from the future (clock skew) shouldn't make everything after them count as late
+        this->last_released = std::min(first.msg.timestamp, now_ms);
+        ready.push_back(std::move(first.msg));
+        run->pop_front();
+        this->held--;
+        if (!run->empty()) {
+            heap.push_back(run);
+            std::push_heap(heap.begin(), heap.end(), by_timestamp);
+        }
+    }
+
+    // Forget runs of providers that went quiet
+    for (auto itr = this->runs.begin(); itr != this->runs.end();) {
+        if (itr->second.empty())
+            itr = this->runs.erase(itr);
+        else
+            itr++;
+    }
+
+    std::lock_guard<std::mutex> guard(this->stats_lock);
+    this->messages += ready.size();
+    this->delayed_messages += ready.size() - passed_through;
+    this->total_delay_ms += delay_sum;
+    this->max_delay_ms = std::max(this->max_delay_ms, delay_max);
+    return ready;
+}
+
+bool timestamp_merger::empty() const {
+    return this->held == 0 && this->immediate.empty();
+}
+
+timestamp_merger::clock::time_point timestamp_merger::next_release(std::chrono::milliseconds window) const {
+    // Anything released immediately is due right now
+    auto now = clock::now();
+    if (!this->immediate.empty())
+        return now;
+    // Otherwise, it's whenever the first run's front reaches the watermark or any front waited for the whole window
+    auto next = clock::time_point::max();
+    long long now_ms = wall_clock_ms();
+    for (auto &run : this->runs) {
+        if (run.second.empty())
+            continue;
+        const entry &first = run.second.front();
+        next = std::min(next, first.arrival + window);
+        next = std::min(next, now + std::chrono::milliseconds(first.msg.timestamp + window.count() - now_ms));
+    }
+    return next;
+}
+
+merge_stats timestamp_merger::get_stats() const {
+    std::lock_guard<std::mutex> guard(this->stats_lock);
+    double average_delay_ms = this->delayed_messages ? this->total_delay_ms / this->delayed_messages : 0;
+    return {this->messages, this->late_messages, this->held, average_delay_ms, this->max_delay_ms};
+}
@@ -0,0 +1,55 @@
+#ifndef STRTB_CHAT_TIMESTAMP_MERGER_H
+#define STRTB_CHAT_TIMESTAMP_MERGER_H
+
+#include "message.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace strtb::chat {
+
+struct merge_stats {
+    uint64_t messages;          // Messages that went through the merger
+    uint64_t late_messages;     // Messages that arrived after newer ones were already released
+    uint64_t held_messages;     // Messages currently waiting to be released
+    double average_delay_ms;    // Average reorder delay of the messages that were held (not the ones passed through)
+    double max_delay_ms;
+};
+
+/* Reorders messages of different providers by their timestamp (milliseconds since the Unix epoch).
+ * Each provider gets its own sorted run, and runs are combined with a k-way heap merge.
+ * A message is held until it's older than the reorder window, or until some message has waited for
+ * the whole window (which also releases everything older than it), so delays stay around the window.
+ * Messages without a timestamp, and ones that arrive too late to be put in order, pass through immediately.
+ */
+class timestamp_merger {
+private:
+    typedef std::chrono::steady_clock clock;
+    struct entry {
+        message msg;
+        clock::time_point arrival;
+    };
+
+    std::map<std::string, std::deque<entry>> runs;
+    std::vector<message> immediate;
+    std::atomic<size_t> held = 0;
+    long long last_released = 0;
+    mutable std::mutex stats_lock;
+    uint64_t messages = 0, late_messages = 0, delayed_messages = 0;
+    double total_delay_ms = 0, max_delay_ms = 0;
+public:
+    void add(std::vector<message> &messages);
+    std::vector<message> take_ready(std::chrono::milliseconds window, bool everything = false);
+    bool empty() const;
+    clock::time_point next_release(std::chrono::milliseconds window) const;
+    merge_stats get_stats() const;
+};
+
+}
+
+#endif // STRTB_CHAT_TIMESTAMP_MERGER_H
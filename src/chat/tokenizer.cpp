@@ -0,0 +1,39 @@
+#include "tokenizer.h"
+
+#include <cctype>
+
+using namespace strtb;
+using namespace strtb::chat;
+
+static bool is_word_separator(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static bool is_ascii_punctuation(unsigned char c) {
+    return c < 0x80 && std::ispunct(c);
+}
+
+std::vector<std::string> chat::split_words(const std::string &text, size_t max_words, bool lowercase) {
+    std::vector<std::string> words;
+    size_t pos = 0, len = text.size();
+    while (pos < len && words.size() < max_words) {
+        while (pos < len && is_word_separator(text[pos]))
+            pos++;
+        size_t start = pos;
+        while (pos < len && !is_word_separator(text[pos]))
+            pos++;
+        size_t end = pos;
+        while (start < end && is_ascii_punctuation(text[start]))
+            start++;
+        while (end > start && is_ascii_punctuation(text[end - 1]))
+            end--;
+        if (start < end) {
+            words.push_back(text.substr(start, end - start));
+            if (lowercase)
+                for (char &c : words.back())
+                    if ('A' <= c && c <= 'Z')
+                        c = c - 'A' + 'a';
+        }
+    }
+    return words;
+}
@@ -0,0 +1,16 @@
+#ifndef STRTB_CHAT_TOKENIZER_H
+#define STRTB_CHAT_TOKENIZER_H
+
+#include <string>
+#include <vector>
+
+namespace strtb::chat {
+
+/* Splits chat text into words on whitespace, trimming ASCII punctuation around them (so "hello!" and "hello" match).
+ * Emotes and non-ASCII text are kept as-is. At most max_words words are returned.
+ */
+std::vector<std::string> split_words(const std::string &text, size_t max_words, bool lowercase = false);
+
+}
+
+#endif // STRTB_CHAT_TOKENIZER_H
@@ -0,0 +1,98 @@
+#include "topology.h"
+
+using namespace strtb;
+using namespace strtb::chat;
+
+void topology::add_change(topology_change_type type, const std::string &provider_id, const std::string &provider_name,
+                          const std::string &channel_id, const std::string &channel_name) {
+    // Must be called with the lock held
+    uint64_t version = this->version.load() + 1;
+    if (this->changes.size() >= max_changes)
+        this->changes.pop_front();
+    this->changes.push_back({version, type, provider_id, provider_name, channel_id, channel_name});
+    // Published last, so anyone who sees the new version will also find its change
+    this->version = version;
+}
+
+void topology::provider_added(const std::string &id, const std::string &name) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->providers[id] = {name, {}};
+    this->add_change(PROVIDER_ADDED, id, name, "", "");
+}
+
+void topology::provider_removed(const std::string &id) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    auto itr = this->providers.find(id);
+    if (itr == this->providers.end())
+        return;
+    // Its channels go away with it
+    for (auto &c_itr : itr->second.channels)
+        this->add_change(CHANNEL_REMOVED, id, itr->second.name, c_itr.first, c_itr.second);
+    this->channel_count -= itr->second.channels.size();
+    this->add_change(PROVIDER_REMOVED, id, itr->second.name, "", "");
+    this->providers.erase(itr);
+}
+
+void topology::channel_added(const std::string &provider_id, const std::string &channel_id, const std::string &channel_name) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    auto itr = this->providers.find(provider_id);
+    if (itr == this->providers.end())
+        return;
+    if (!itr->second.channels.emplace(channel_id, channel_name).second)
+        return;
+    this->channel_count++;
+    this->add_change(CHANNEL_ADDED, provider_id, itr->second.name, channel_id, channel_name);
+}
+
+void topology::channel_removed(const std::string &provider_id, const std::string &channel_id) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    auto itr = this->providers.find(provider_id);
+    if (itr == this->providers.end())
+        return;
+    auto c_itr = itr->second.channels.find(channel_id);
+    if (c_itr == itr->second.channels.end())
+        return;
+    this->add_change(CHANNEL_REMOVED, provider_id, itr->second.name, channel_id, c_itr->second);
+    itr->second.channels.erase(c_itr);
+    this->channel_count--;
+}
+
+uint64_t topology::get_version() {
+    return this->version;
+}
+
+bool topology::get_changes(uint64_t since, std::vector<topology_change> &out) {
+    // Quick path for consumers that are already up to date
+    if (since >= this->version)
+        return true;
+    std::lock_guard<std::mutex> guard(this->lock);
+    // Changes are kept in version order with no gaps, so the first one we need is found by offset
+    uint64_t oldest = this->changes.empty() ? this->version.load() + 1 : this->changes.front().version;
+    if (since + 1 < oldest)
+        // Some needed changes were already dropped, so the consumer needs a new snapshot
+        return false;
+    for (auto itr = this->changes.begin() + (since + 1 - oldest); itr != this->changes.end(); itr++)
+        out.push_back(*itr);
+    return true;
+}
+
+system_channel_info topology::get_snapshot(uint64_t *version) {
+    std::lock_guard<std::mutex> guard(this->lock);
+    system_channel_info info;
+    info.provider_count = this->providers.size();
+    info.channel_count = this->channel_count;
+    info.providers.reserve(this->providers.size());
+    for (auto &p_itr : this->providers) {
+        provider_info p_info;
+        p_info.id = p_itr.first;
+        p_info.name = p_itr.second.name;
+        p_info.channel_count = p_itr.second.channels.size();
+        p_info.channels.reserve(p_itr.second.channels.size());
+        for (auto &c_itr : p_itr.second.channels)
+            p_info.channels.push_back({c_itr.first, c_itr.second});
+        info.providers.push_back(std::move(p_info));
+    }
+    if (version)
+        *version = this->version;
+    return info;
+}
@@ -0,0 +1,67 @@
+#ifndef STRTB_CHAT_TOPOLOGY_H
+#define STRTB_CHAT_TOPOLOGY_H
+
+#include "provider.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+namespace strtb::chat {
+
+struct system_channel_info {
+    int provider_count;
+    int channel_count;
+    std::vector<provider_info> providers;
+};
+
+enum topology_change_type {PROVIDER_ADDED, PROVIDER_REMOVED, CHANNEL_ADDED, CHANNEL_REMOVED};
+
+struct topology_change {
+    uint64_t version;   // Topology version right after this change
+    topology_change_type type;
+    std::string provider_id, provider_name;
+    std::string channel_id, channel_name;   // Empty for provider changes
+};
+
+/* Mirror of the registered providers and channels, kept up to date by them as they come and go.
+ * Every change bumps the version and is kept in a bounded change log, so consumers can check the version
+ * cheaply and only apply the changes since the version they last saw, instead of copying the whole tree.
+ * A removed provider first gets a removal for each of its remaining channels.
+ */
+class topology {
+public:
+    static constexpr size_t max_changes = 1024;
+private:
+    struct provider_entry {
+        std::string name;
+        std::map<std::string, std::string> channels;    // ID -> name
+    };
+
+    std::mutex lock;
+    std::atomic<uint64_t> version = 0;
+    std::map<std::string, provider_entry> providers;
+    size_t channel_count = 0;
+    std::deque<topology_change> changes;
+
+    void add_change(topology_change_type type, const std::string &provider_id, const std::string &provider_name,
+                    const std::string &channel_id, const std::string &channel_name);
+protected:
+    friend class system;
+    friend class provider;
+    void provider_added(const std::string &id, const std::string &name);
+    void provider_removed(const std::string &id);
+    void channel_added(const std::string &provider_id, const std::string &channel_id, const std::string &channel_name);
+    void channel_removed(const std::string &provider_id, const std::string &channel_id);
+public:
+    uint64_t get_version();
+    bool get_changes(uint64_t since, std::vector<topology_change> &out);
+    system_channel_info get_snapshot(uint64_t *version = nullptr);
+};
+
+}
+
+#endif // STRTB_CHAT_TOPOLOGY_H
@@ -77,6 +77,10 @@ std::string common::string_escape(const char* str, char escape_quote_char, bool
 }
 
 std::string common::string_escape(const std::string &str, char escape_quote_char, bool quoted) {
+    return string_escape(std::string_view(str), escape_quote_char, quoted);
+}
+
+std::string common::string_escape(std::string_view str, char escape_quote_char, bool quoted) {
     std::string escaped;
 
     // Opening quote
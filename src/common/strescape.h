@@ -2,12 +2,14 @@
 #define STRTB_COMMON_STRESCAPE_H
 
 #include <string>
+#include <string_view>
 
 namespace strtb::common {
 
 std::string char_escape(char c, char escape_quote_char = '\'', bool quoted = true);
 std::string string_escape(const char* str, char escape_quote_char = '"', bool quoted = true);
 std::string string_escape(const std::string &str, char escape_quote_char = '"', bool quoted = true);
+std::string string_escape(std::string_view str, char escape_quote_char = '"', bool quoted = true);
 
 }
 
@@ -0,0 +1,34 @@
+#include "arena.h"
+
+#include <new>
+
+using namespace strtb;
+using namespace strtb::json;
+
+namespace {
+
+class heap_resource : public std::pmr::memory_resource {
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            return ::operator new(bytes);
+        return ::operator new(bytes, std::align_val_t(alignment));
+    }
+    void do_deallocate(void *ptr, size_t, size_t alignment) override {
+        if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+            ::operator delete(ptr);
+        else
+            ::operator delete(ptr, std::align_val_t(alignment));
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+};
+
+}
+
+std::pmr::memory_resource* arena::heap() {
+    // Never destroyed, since values might still be freed while the program exits
+    static heap_resource *resource = new heap_resource();
+    return resource;
+}
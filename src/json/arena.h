@@ -0,0 +1,51 @@
+#ifndef STRTB_JSON_ARENA_H
+#define STRTB_JSON_ARENA_H
+
+#include <memory_resource>
+#include <utility>
+
+namespace strtb::json {
+
+/* Monotonic memory for building JSON documents. Values made in an arena (and their strings, arrays and object
+ * members) are bump-allocated from big blocks, and are all freed at once when the arena is released or destroyed,
+ * without walking the tree. Values in an arena must never be deleted on their own.
+ * Containers in an arena only hold values of the same arena: values from elsewhere are copied in when moved into
+ * them (and heap values are deleted after being copied), and values of an arena are copied out when moved into a
+ * heap container. Only one thread may use an arena at a time.
+ */
+class arena : public std::pmr::monotonic_buffer_resource {
+public:
+    arena() : std::pmr::monotonic_buffer_resource(64 * 1024) {}
+    explicit arena(size_t initial_size) : std::pmr::monotonic_buffer_resource(initial_size) {}
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    // Constructs a value in this arena
+    template<class T, class... Args>
+    T* make(Args&&... args) {
+        return new (this->allocate(sizeof(T), alignof(T))) T(this, std::forward<Args>(args)...);
+    }
+
+    // Memory resource for values of the given arena (nullptr means the heap)
+    static std::pmr::memory_resource* resource(arena *arena) {
+        if (arena)
+            return arena;
+        return heap();
+    }
+
+    // Memory resource for values outside of arenas. Unlike std::pmr::new_delete_resource(), it uses the plain
+    // operator new for normal alignments, which is a lot faster than the aligned one for lots of small allocations.
+    static std::pmr::memory_resource* heap();
+};
+
+// Constructs a value in the given arena, or on the heap if it's nullptr
+template<class T, class... Args>
+T* make(class arena *arena, Args&&... args) {
+    if (arena)
+        return arena->make<T>(std::forward<Args>(args)...);
+    return new T(arena, std::forward<Args>(args)...);
+}
+
+}
+
+#endif // STRTB_JSON_ARENA_H
@@ -0,0 +1,460 @@
+#include "compact.h"
+#include "all_value_types.h"
+#include "arena.h"
+#include "writer.h"
+
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace strtb;
+using namespace strtb::json;
+
+static_assert(sizeof(compact) == 16, "compact values should stay 16 bytes");
+
+// Header of the storage of arrays and objects, followed by the items themselves
+struct compact::block {
+    uint32_t size;
+    uint32_t capacity;
+};
+
+compact::compact() : _int(0), _tag(VAL_NULL) {}
+
+compact::compact(std::nullptr_t) : compact() {}
+
+compact::compact(bool val) : _bool(val), _tag(VAL_BOOL) {}
+
+compact::compact(int val) : _int(val), _tag(VAL_INT) {}
+
+compact::compact(long val) : _int(val), _tag(VAL_INT) {}
+
+compact::compact(long long val) : _int(val), _tag(VAL_INT) {}
+
+compact::compact(unsigned int val) : _int(val), _tag(VAL_INT) {}
+
+compact::compact(unsigned long val) : _int(val), _tag(VAL_INT) {}
+
+compact::compact(unsigned long long val) : _int(val), _tag(VAL_INT) {}
+
+compact::compact(double val) : _float(val), _tag(VAL_FLOAT) {}
+
+compact::compact(const char* val) {set_string(val);}
+
+compact::compact(std::string_view val) {set_string(val);}
+
+compact::compact(const std::string &val) {set_string(val);}
+
+compact::compact(val_type type) : _int(0), _tag(type) {
+    switch (type) {
+    case VAL_NULL:
+    case VAL_BOOL:
+    case VAL_INT:
+        break;
+    case VAL_FLOAT:
+        _float = 0;
+        break;
+    case VAL_STRING:
+        set_string(std::string_view());
+        break;
+    case VAL_ARRAY:
+    case VAL_OBJECT:
+        _block = nullptr;   // Storage is allocated on the first insertion
+        break;
+    default:
+        throw invalid_type();
+    }
+}
+
+compact::compact(const compact &from) : _tag(VAL_NULL) {copy_from(from);}
+
+compact::compact(compact &&from) noexcept {
+    // Nothing points into a value itself, so moving it is a plain copy of its bytes
+    memcpy((void*) this, (const void*) &from, sizeof(compact));
+    from._tag = VAL_NULL;
+}
+
+compact& compact::operator=(compact from) noexcept {
+    // from is already a copy (or was moved from the original), so it's safe even if it came from inside this value
+    destroy();
+    memcpy((void*) this, (const void*) &from, sizeof(compact));
+    from._tag = VAL_NULL;
+    return *this;
+}
+
+compact::~compact() {destroy();}
+
+void compact::set_string(std::string_view str) {
+    _tag = VAL_STRING;
+    if (str.size() <= small_capacity) {
+        memcpy((char*) this, str.data(), str.size());
+        _small_length = str.size();
+    } else {
+        if (str.size() > UINT32_MAX)
+            throw std::length_error("String too long");
+        _chars = new char[str.size()];
+        memcpy(_chars, str.data(), str.size());
+        _length = str.size();
+        _small_length = long_string;
+    }
+}
+
+void compact::copy_from(const compact &from) {
+    // Called on a null value, which is left as it is if copying fails
+    switch (from._tag) {
+    case VAL_STRING:
+        set_string(from.as_string());
+        break;
+    case VAL_ARRAY:
+    case VAL_OBJECT: {
+        compact copy(val_type(from._tag));
+        if (from._tag == VAL_ARRAY) {
+            copy.reserve(from.size());
+            for (const auto &item : from.items())
+                copy.push_back(item);
+        } else {
+            copy.reserve(from.size());
+            for (const auto &item : from.members())
+                copy.append_member(item.key.as_string(), compact(item.value));
+        }
+        *this = std::move(copy);
+        break;
+    }
+    default:
+        memcpy((void*) this, (const void*) &from, sizeof(compact));
+    }
+}
+
+void compact::destroy() {
+    switch (_tag) {
+    case VAL_STRING:
+        if (_small_length == long_string)
+            delete[] _chars;
+        break;
+    case VAL_ARRAY:
+        if (_block) {
+            compact *items = array_items();
+            for (size_t i=0; i<_block->size; i++)
+                items[i].~compact();
+            ::operator delete(_block);
+        }
+        break;
+    case VAL_OBJECT:
+        if (_block) {
+            member *members = object_members();
+            for (size_t i=0; i<_block->size; i++)
+                members[i].~member();
+            ::operator delete(_block);
+        }
+        break;
+    }
+    _tag = VAL_NULL;
+}
+
+compact* compact::array_items() const {return (compact*) (_block + 1);}
+
+compact::member* compact::object_members() const {return (member*) (_block + 1);}
+
+void compact::reserve_items(size_t capacity, size_t item_size) {
+    size_t size = _block ? _block->size : 0;
+    if (capacity <= (_block ? _block->capacity : 0))
+        return;
+    if (capacity > UINT32_MAX)
+        throw std::length_error("Too many items");
+    block *new_block = (block*) ::operator new(sizeof(block) + capacity * item_size);
+    new_block->size = size;
+    new_block->capacity = capacity;
+    // Items are moved over byte by byte, for the same reason as in the move constructor
+    if (_block) {
+        memcpy((void*) (new_block + 1), (const void*) (_block + 1), size * item_size);
+        ::operator delete(_block);
+    }
+    _block = new_block;
+}
+
+void compact::append_member(std::string_view key, compact &&val) {
+    if (!_block || _block->size == _block->capacity)
+        reserve_items(_block ? _block->capacity * 2 : 4, sizeof(member));
+    new (object_members() + _block->size) member{compact(key), std::move(val)};
+    _block->size++;
+}
+
+val_type compact::type() const {return (val_type) _tag;}
+
+bool compact::as_bool() const {
+    if (_tag != VAL_BOOL)
+        throw invalid_type();
+    return _bool;
+}
+
+long long compact::as_int() const {
+    if (_tag != VAL_INT)
+        throw invalid_type();
+    return _int;
+}
+
+double compact::as_float() const {
+    if (_tag != VAL_FLOAT)
+        throw invalid_type();
+    return _float;
+}
+
+std::string_view compact::as_string() const {
+    if (_tag != VAL_STRING)
+        throw invalid_type();
+    if (_small_length == long_string)
+        return std::string_view(_chars, _length);
+    return std::string_view((const char*) this, _small_length);
+}
+
+compact::array_range compact::items() const {
+    if (_tag != VAL_ARRAY)
+        throw invalid_type();
+    if (!_block)
+        return array_range(nullptr, nullptr);
+    return array_range(array_items(), array_items() + _block->size);
+}
+
+compact::object_range compact::members() const {
+    if (_tag != VAL_OBJECT)
+        throw invalid_type();
+    if (!_block)
+        return object_range(nullptr, nullptr);
+    return object_range(object_members(), object_members() + _block->size);
+}
+
+size_t compact::size() const {
+    if (_tag != VAL_ARRAY && _tag != VAL_OBJECT)
+        throw invalid_type();
+    return _block ? _block->size : 0;
+}
+
+void compact::reserve(size_t capacity) {
+    if (_tag == VAL_ARRAY)
+        reserve_items(capacity, sizeof(compact));
+    else if (_tag == VAL_OBJECT)
+        reserve_items(capacity, sizeof(member));
+    else
+        throw invalid_type();
+}
+
+void compact::clear() {
+    if (_tag != VAL_ARRAY && _tag != VAL_OBJECT)
+        throw invalid_type();
+    *this = compact(type());
+}
+
+compact& compact::at(size_t pos) {
+    if (_tag != VAL_ARRAY)
+        throw invalid_type();
+    if (pos >= size())
+        throw std::out_of_range("Out of range");
+    return array_items()[pos];
+}
+
+const compact& compact::at(size_t pos) const {
+    if (_tag != VAL_ARRAY)
+        throw invalid_type();
+    if (pos >= size())
+        throw std::out_of_range("Out of range");
+    return array_items()[pos];
+}
+
+void compact::push_back(compact val) {
+    if (_tag != VAL_ARRAY)
+        throw invalid_type();
+    if (!_block || _block->size == _block->capacity)
+        reserve_items(_block ? _block->capacity * 2 : 4, sizeof(compact));
+    new (array_items() + _block->size) compact(std::move(val));
+    _block->size++;
+}
+
+void compact::pop_back() {
+    if (_tag != VAL_ARRAY)
+        throw invalid_type();
+    if (size() == 0)
+        throw std::out_of_range("Array is empty");
+    _block->size--;
+    array_items()[_block->size].~compact();
+}
+
+void compact::erase(size_t pos) {
+    if (_tag != VAL_ARRAY)
+        throw invalid_type();
+    if (pos >= size())
+        throw std::out_of_range("Out of range");
+    compact *items = array_items();
+    items[pos].~compact();
+    memmove((void*) (items + pos), (const void*) (items + pos + 1), (_block->size - pos - 1) * sizeof(compact));
+    _block->size--;
+}
+
+compact::member* compact::find_member(std::string_view key) const {
+    for (const auto &item : members())
+        if (item.key.as_string() == key)
+            return (member*) &item;
+    return nullptr;
+}
+
+compact* compact::find(std::string_view key) {
+    member *item = find_member(key);
+    return item ? &item->value : nullptr;
+}
+
+const compact* compact::find(std::string_view key) const {
+    const member *item = find_member(key);
+    return item ? &item->value : nullptr;
+}
+
+compact& compact::at(std::string_view key) {
+    compact *val = find(key);
+    if (!val)
+        throw std::out_of_range("Key not found");
+    return *val;
+}
+
+const compact& compact::at(std::string_view key) const {
+    const compact *val = find(key);
+    if (!val)
+        throw std::out_of_range("Key not found");
+    return *val;
+}
+
+bool compact::insert(std::string_view key, compact val) {
+    if (find(key))
+        return false;
+    append_member(key, std::move(val));
+    return true;
+}
+
+void compact::set(std::string_view key, compact val) {
+    compact *existing = find(key);
+    if (existing)
+        *existing = std::move(val);
+    else
+        append_member(key, std::move(val));
+}
+
+void compact::erase(std::string_view key) {
+    member *item = find_member(key);
+    if (!item)
+        throw std::out_of_range("Key not found");
+    member *members = object_members();
+    size_t pos = item - members;
+    item->~member();
+    memmove((void*) (members + pos), (const void*) (members + pos + 1), (_block->size - pos - 1) * sizeof(member));
+    _block->size--;
+}
+
+compact compact::from_value(const value &val) {
+    switch (val.type()) {
+    case VAL_NULL:
+        return compact();
+    case VAL_BOOL:
+        return compact(((const value_bool&) val).value());
+    case VAL_INT:
+        return compact(((const value_int&) val).value());
+    case VAL_FLOAT:
+        return compact(((const value_float&) val).value());
+    case VAL_STRING:
+        return compact(((const value_string&) val).value_view());
+    case VAL_ARRAY: {
+        const value_array &arr = (const value_array&) val;
+        compact copy(VAL_ARRAY);
+        copy.reserve(arr.size());
+        for (const auto item : arr)
+            copy.push_back(from_value(*item));
+        return copy;
+    }
+    case VAL_OBJECT: {
+        const value_object &obj = (const value_object&) val;
+        compact copy(VAL_OBJECT);
+        copy.reserve(obj.size());
+        // Keys of an object are already unique
+        for (const auto &item : obj)
+            copy.append_member(item.first, from_value(*item.second));
+        return copy;
+    }
+    default:
+        throw invalid_type();
+    }
+}
+
+value* compact::to_value(class arena *arena) const {
+    switch (type()) {
+    case VAL_NULL:
+        return make<value_null>(arena);
+    case VAL_BOOL:
+        return make<value_bool>(arena, _bool);
+    case VAL_INT:
+        return make<value_int>(arena, _int);
+    case VAL_FLOAT:
+        return make<value_float>(arena, _float);
+    case VAL_STRING:
+        return make<value_string>(arena, as_string());
+    case VAL_ARRAY: {
+        value_array *arr = make<value_array>(arena);
+        try {
+            for (const auto &item : items())
+                arr->push_back_move(item.to_value(arena));
+        } catch (...) {
+            value_utils::release(arr);
+            throw;
+        }
+        return arr;
+    }
+    default: {
+        value_object *obj = make<value_object>(arena);
+        try {
+            for (const auto &item : members())
+                obj->set_move(std::string(item.key.as_string()), item.value.to_value(arena));
+        } catch (...) {
+            value_utils::release(obj);
+            throw;
+        }
+        return obj;
+    }
+    }
+}
+
+void compact::write(writer &out) const {
+    visit([&](const auto &val) {
+        typedef std::decay_t<decltype(val)> T;
+        if constexpr (std::is_same_v<T, std::nullptr_t>) {
+            out.null();
+        } else if constexpr (std::is_same_v<T, bool>) {
+            out.boolean(val);
+        } else if constexpr (std::is_same_v<T, long long>) {
+            out.integer(val);
+        } else if constexpr (std::is_same_v<T, double>) {
+            out.fraction(val);
+        } else if constexpr (std::is_same_v<T, std::string_view>) {
+            out.string(val);
+        } else if constexpr (std::is_same_v<T, array_range>) {
+            out.start_array();
+            for (const auto &item : val)
+                item.write(out);
+            out.end_array();
+        } else {
+            out.start_object();
+            for (const auto &item : val) {
+                out.key(item.key.as_string());
+                item.value.write(out);
+            }
+            out.end_object();
+        }
+    });
+}
+
+void compact::write_to_stream(std::ostream &stream, int pretty_print, const char* newline) const {
+    writer out(stream, pretty_print, newline);
+    write(out);
+    out.flush();
+}
+
+std::string compact::write_to_string(int pretty_print, const char* newline) const {
+    std::string str;
+    writer out(str, pretty_print, newline);
+    write(out);
+    return str;
+}
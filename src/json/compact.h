@@ -0,0 +1,159 @@
+#ifndef STRTB_JSON_COMPACT_H
+#define STRTB_JSON_COMPACT_H
+
+#include "value.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <iostream>
+
+namespace strtb::json {
+
+/* Compact alternative to the value classes, without virtual functions or a heap object per value.
+ * Every value is 16 bytes: scalars and strings of up to 14 bytes are stored inline, and only longer strings,
+ * arrays and objects allocate. Array items and object members are stored next to each other, so walking a tree
+ * doesn't chase a pointer per value. Objects keep their members in insertion order and are searched linearly,
+ * which suits the small objects most documents are made of.
+ * Values are copied deeply, and can be converted to and from the value classes.
+ */
+class compact {
+public:
+    struct member;
+
+    // Read-only view of the items of an array or the members of an object
+    template<class T>
+    class range {
+    private:
+        const T *_begin, *_end;
+    public:
+        range(const T *begin, const T *end) : _begin(begin), _end(end) {}
+        const T* begin() const {return _begin;}
+        const T* end() const {return _end;}
+        size_t size() const {return _end - _begin;}
+        bool empty() const {return _begin == _end;}
+        const T& operator[](size_t pos) const {return _begin[pos];}
+    };
+    typedef range<compact> array_range;
+    typedef range<member> object_range;
+
+    // Longest string stored inside the value itself
+    static const size_t small_capacity = 14;
+
+private:
+    struct block;
+
+    // Small strings use the first 14 bytes of the value in place of these fields
+    union {
+        bool _bool;
+        long long _int;
+        double _float;
+        char *_chars;       // Long strings
+        block *_block;      // Arrays and objects
+    };
+    uint32_t _length;       // Length of long strings
+    uint8_t _unused[2];
+    uint8_t _small_length;  // Length of small strings, or long_string
+    uint8_t _tag;           // val_type
+
+    static const uint8_t long_string = 0xff;
+
+    void set_string(std::string_view str);
+    void copy_from(const compact &from);
+    void destroy();
+    compact* array_items() const;
+    member* object_members() const;
+    member* find_member(std::string_view key) const;
+    void reserve_items(size_t capacity, size_t item_size);
+    void append_member(std::string_view key, compact &&val);
+    void write(class writer &out) const;
+
+public:
+    compact();
+    compact(std::nullptr_t);
+    compact(bool val);
+    compact(int val);
+    compact(long val);
+    compact(long long val);
+    compact(unsigned int val);
+    compact(unsigned long val);
+    compact(unsigned long long val);
+    compact(double val);
+    compact(const char* val);
+    compact(std::string_view val);
+    compact(const std::string &val);
+    explicit compact(val_type type);        // Default value of the given type, like value_utils::new_default()
+    compact(const compact &from);
+    compact(compact &&from) noexcept;
+    compact& operator=(compact from) noexcept;
+    ~compact();
+
+    val_type type() const;
+    // These throw invalid_type if the value is of another type
+    bool as_bool() const;
+    long long as_int() const;
+    double as_float() const;
+    std::string_view as_string() const;
+    array_range items() const;
+    object_range members() const;
+
+    // Number of array items or object members
+    size_t size() const;
+    void reserve(size_t capacity);
+    void clear();
+
+    // Arrays
+    compact& at(size_t pos);
+    const compact& at(size_t pos) const;
+    void push_back(compact val);
+    void pop_back();
+    void erase(size_t pos);
+
+    // Objects
+    compact* find(std::string_view key);
+    const compact* find(std::string_view key) const;
+    compact& at(std::string_view key);
+    const compact& at(std::string_view key) const;
+    bool insert(std::string_view key, compact val);     // Fails (returning false) if the key already exists
+    void set(std::string_view key, compact val);        // Replaces the existing value if there is one
+    void erase(std::string_view key);
+
+    // Calls the visitor with nullptr, bool, long long, double, std::string_view, array_range or object_range,
+    // depending on the type of the value
+    template<class visitor>
+    decltype(auto) visit(visitor &&v) const {
+        switch (type()) {
+        case VAL_NULL:
+            return v(nullptr);
+        case VAL_BOOL:
+            return v(_bool);
+        case VAL_INT:
+            return v(_int);
+        case VAL_FLOAT:
+            return v(_float);
+        case VAL_STRING:
+            return v(as_string());
+        case VAL_ARRAY:
+            return v(items());
+        default:
+            return v(members());
+        }
+    }
+
+    // Conversion to and from the value classes
+    static compact from_value(const value &val);
+    value* to_value(class arena *arena = nullptr) const;    // Made in the given arena, or on the heap if it's nullptr
+
+    void write_to_stream(std::ostream &stream, int pretty_print = 0, const char* newline = "\n") const;
+    std::string write_to_string(int pretty_print = 0, const char* newline = "\n") const;
+};
+
+struct compact::member {
+    compact key;
+    compact value;
+};
+
+}
+
+#endif // STRTB_JSON_COMPACT_H
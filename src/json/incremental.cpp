@@ -0,0 +1,165 @@
+#include "incremental.h"
+#include "parser.h"
+#include "parser_core.h"
+
+using namespace strtb;
+using namespace strtb::json::parser;
+
+static bool ends_scalar(char c) {
+    return cursor::is_whitespace(c) || c == '{' || c == '}' || c == '[' || c == ']' || c == ',' || c == ':' || c == '"';
+}
+
+incremental::incremental(class arena *arena) : _arena(arena) {}
+
+void incremental::feed(const char *data, size_t size) {
+    // Drop what was already handed out once it's at least half of the buffer, so moving the rest is amortized
+    if (_start > 0 && _start >= _buffer.size() / 2) {
+        _buffer.erase(0, _start);
+        _pos -= _start;
+        if (_state != SCAN_BETWEEN)
+            _value_start -= _start;
+        _start = 0;
+    }
+    _buffer.append(data, size);
+}
+
+void incremental::feed(const std::string &data) {feed(data.data(), data.size());}
+
+void incremental::finish() {_finished = true;}
+
+json::value* incremental::next() {
+    size_t value_end;
+    if (!scan(value_end)) {
+        // Nothing complete yet, but whitespace between values doesn't need to be kept
+        if (_state == SCAN_BETWEEN)
+            consume(_pos);
+        return nullptr;
+    }
+
+    size_t value_start = _value_start;
+    consume(value_start);
+    size_t start_line = _line, start_col = _col;
+    consume(value_end);
+    try {
+        return from_buffer(_buffer.data() + value_start, value_end - value_start, _arena);
+    } catch (invalid_json &e) {
+        // Report where the error is in the whole stream
+        size_t line = start_line + e.line() - 1;
+        size_t col = e.line() == 1 ? start_col + e.col() - 1 : e.col();
+        throw invalid_json(line, col);
+    }
+}
+
+bool incremental::scan(size_t &value_end) {
+    const char *data = _buffer.data();
+    size_t size = _buffer.size();
+
+    while (_pos < size) {
+        char c = data[_pos];
+        switch (_state) {
+        case SCAN_BETWEEN:
+            if (cursor::is_whitespace(c)) {
+                _pos++;
+                break;
+            }
+            _value_start = _pos++;
+            if (c == '{' || c == '[') {
+                _state = SCAN_CONTAINER;
+                _depth = 1;
+                _in_string = false;
+            } else if (c == '"') {
+                _state = SCAN_STRING;
+                _escaped = false;
+            } else if (c == '}' || c == ']' || c == ',' || c == ':') {
+                // Can't start a value, so let the parser report it on its own
+                value_end = _pos;
+                return true;
+            } else {
+                _state = SCAN_SCALAR;
+            }
+            break;
+
+        case SCAN_CONTAINER:
+            if (_in_string) {
+                // Skip ahead to anything that could end the string
+                if (!_escaped)
+                    while (_pos < size && data[_pos] != '"' && data[_pos] != '\\')
+                        _pos++;
+                if (_pos == size)
+                    break;
+                c = data[_pos++];
+                if (_escaped)
+                    _escaped = false;
+                else if (c == '\\')
+                    _escaped = true;
+                else
+                    _in_string = false;
+                break;
+            }
+            _pos++;
+            if (c == '"') {
+                _in_string = true;
+                _escaped = false;
+            } else if (c == '{' || c == '[') {
+                _depth++;
+            } else if ((c == '}' || c == ']') && --_depth == 0) {
+                _state = SCAN_BETWEEN;
+                value_end = _pos;
+                return true;
+            }
+            break;
+
+        case SCAN_STRING:
+            if (!_escaped)
+                while (_pos < size && data[_pos] != '"' && data[_pos] != '\\')
+                    _pos++;
+            if (_pos == size)
+                break;
+            c = data[_pos++];
+            if (_escaped) {
+                _escaped = false;
+            } else if (c == '\\') {
+                _escaped = true;
+            } else {
+                _state = SCAN_BETWEEN;
+                value_end = _pos;
+                return true;
+            }
+            break;
+
+        case SCAN_SCALAR:
+            // Ends right before whatever comes after it
+            if (ends_scalar(c)) {
+                _state = SCAN_BETWEEN;
+                value_end = _pos;
+                return true;
+            }
+            _pos++;
+            break;
+        }
+    }
+
+    if (_finished && _state != SCAN_BETWEEN) {
+        // The stream is over, so whatever is left is all of the last value (and the parser decides if it's valid)
+        _state = SCAN_BETWEEN;
+        value_end = size;
+        return true;
+    }
+    return false;
+}
+
+void incremental::consume(size_t end) {
+    // Lines and columns are counted like invalid_json does (CR, LF and CRLF all count as one line break)
+    const char *data = _buffer.data();
+    for (size_t i = _start; i < end; i++) {
+        char c = data[i];
+        if (c == '\r' || (c == '\n' && _prev != '\r')) {
+            _line++;
+            _col = 1;
+        } else if (c != '\n') {
+            _col++;
+        }
+        _prev = c;
+    }
+    _start = end;
+}
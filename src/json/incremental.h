@@ -0,0 +1,55 @@
+#ifndef STRTB_JSON_INCREMENTAL_H
+#define STRTB_JSON_INCREMENTAL_H
+
+#include "value.h"
+
+#include <string>
+
+namespace strtb::json::parser {
+
+/* Parses a stream of JSON values that arrives in chunks of any size (like fragmented websocket frames).
+ * Bytes are scanned only once as they come in, keeping track of strings and nesting, and each top-level value is
+ * parsed as soon as it's complete. Values can follow each other with or without whitespace in between, so
+ * newline-delimited JSON works too. Top-level numbers and literals can only be known to be complete once
+ * something follows them, or once finish() is called.
+ * An invalid value throws invalid_json (with its position in the whole stream) from next(), and is skipped, so
+ * values after it can still be read.
+ */
+class incremental {
+private:
+    enum scan_state {SCAN_BETWEEN, SCAN_CONTAINER, SCAN_STRING, SCAN_SCALAR};
+
+    class arena *_arena;
+    std::string _buffer;
+    size_t _start = 0;          // First byte not handed out yet
+    size_t _pos = 0;            // Next byte to scan
+    size_t _value_start = 0;    // Start of the value being scanned
+    scan_state _state = SCAN_BETWEEN;
+    size_t _depth = 0;
+    bool _in_string = false;
+    bool _escaped = false;
+    bool _finished = false;
+    // Position of _start in the stream, for error messages
+    size_t _line = 1, _col = 1;
+    char _prev = 0;
+
+    bool scan(size_t &value_end);
+    void consume(size_t end);
+public:
+    incremental(class arena *arena = nullptr);     // Values are put in the arena if one is given
+    incremental(const incremental&) = delete;
+    incremental& operator=(const incremental&) = delete;
+
+    void feed(const char *data, size_t size);
+    void feed(const std::string &data);
+    // Marks the end of the stream, so a value still left at the end is either completed or reported as invalid
+    void finish();
+    // Next complete value, or nullptr if there isn't one yet
+    json::value* next();
+    // Bytes kept for values that aren't complete yet
+    size_t buffered() const {return _buffer.size() - _start;}
+};
+
+}
+
+#endif // STRTB_JSON_INCREMENTAL_H
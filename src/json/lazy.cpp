@@ -0,0 +1,227 @@
+#include "lazy.h"
+#include "parser.h"
+#include "parser_core.h"
+#include "reader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+
+using namespace strtb;
+using namespace strtb::json::parser;
+
+static const size_t not_found = (size_t) -1;
+
+namespace {
+
+// Keys of an object being validated. Most objects are small enough to search linearly, and big ones get a hash set.
+// Keys are looked at in the buffer when they have no escapes, and only copied otherwise.
+class key_set {
+private:
+    static const size_t max_linear = 32;
+    std::vector<std::string_view> small;
+    std::unordered_set<std::string_view> big;
+    std::deque<std::string> unescaped;
+public:
+    void clear() {
+        small.clear();
+        big.clear();
+        unescaped.clear();
+    }
+
+    // Returns false if the key was already there
+    bool insert(const char *raw, const std::string &value) {
+        // raw is right after the opening quote. Keys without escapes read the same there, and the buffer outlives us.
+        std::string_view key(raw, value.size());
+        if (raw[value.size()] != '"' || memcmp(raw, value.data(), value.size()) != 0)
+            key = unescaped.emplace_back(value);
+        if (big.empty()) {
+            for (auto &other : small)
+                if (other == key)
+                    return false;
+            if (small.size() < max_linear) {
+                small.push_back(key);
+                return true;
+            }
+            big.insert(small.begin(), small.end());
+            small.clear();
+        }
+        return big.insert(key).second;
+    }
+};
+
+}
+
+lazy::lazy(const char *data, size_t size) : _data(data), _size(size) {
+    // Validate everything once, remembering where each container ends so lookups can jump over it
+    reader in(data, size);
+    std::vector<size_t> open;       // Position in _containers of each container we're in
+    std::vector<size_t> duplicate;  // Where a repeated key is in each container we're in (or not_found)
+    std::deque<key_set> keys;       // Keys of each object we're in (kept around to be reused, and never moved since they point into themselves)
+    size_t objects = 0;
+    token t = in.next();
+    _root = in.token_offset();
+    for (; t != TOKEN_END; t = in.next()) {
+        if (t == TOKEN_START_ARRAY || t == TOKEN_START_OBJECT) {
+            open.push_back(_containers.size());
+            duplicate.push_back(not_found);
+            _containers.emplace_back(in.token_offset(), 0);
+            if (t == TOKEN_START_OBJECT) {
+                if (objects == keys.size())
+                    keys.emplace_back();
+                keys[objects++].clear();
+            }
+            continue;
+        }
+        if (t == TOKEN_KEY) {
+            if (!keys[objects - 1].insert(data + in.token_offset() + 1, in.string_value()) && duplicate.back() == not_found)
+                duplicate.back() = in.token_offset();
+            continue;
+        }
+        if (t == TOKEN_END_ARRAY || t == TOKEN_END_OBJECT) {
+            _containers[open.back()].second = in.token_offset() + 1;
+            open.pop_back();
+            duplicate.pop_back();
+            if (t == TOKEN_END_OBJECT)
+                objects--;
+        }
+        // A value just ended. The parser rejects a repeated key once it has read its value, so do the same here, to
+        // report the same error when there's more than one.
+        if (!duplicate.empty() && duplicate.back() != not_found)
+            in.fail_at(duplicate.back());
+    }
+}
+
+bool lazy::contains(std::string_view pointer) const {return find(pointer) != not_found;}
+
+std::string_view lazy::raw(std::string_view pointer) const {
+    size_t start = find(pointer);
+    if (start == not_found)
+        throw std::out_of_range("No value at JSON pointer");
+    return std::string_view(_data + start, value_end(start) - start);
+}
+
+json::value* lazy::get(std::string_view pointer, class arena *arena) const {
+    std::string_view text = raw(pointer);
+    return from_buffer(text.data(), text.size(), arena);
+}
+
+size_t lazy::find(std::string_view pointer) const {
+    if (pointer.empty())
+        return _root;
+    if (pointer[0] != '/')
+        throw std::invalid_argument("JSON pointer doesn't start with '/'");
+
+    size_t pos = _root;
+    std::string unescaped;
+    size_t token_start = 1;
+    while (true) {
+        size_t slash = pointer.find('/', token_start);
+        std::string_view token = pointer.substr(token_start, slash == std::string_view::npos ? slash : slash - token_start);
+        // Undo the escapes of '~' (~0) and '/' (~1)
+        if (token.find('~') != std::string_view::npos) {
+            unescaped.clear();
+            for (size_t i=0; i<token.size(); i++) {
+                if (token[i] != '~') {
+                    unescaped.push_back(token[i]);
+                } else if (i + 1 < token.size() && (token[i+1] == '0' || token[i+1] == '1')) {
+                    unescaped.push_back(token[++i] == '0' ? '~' : '/');
+                } else {
+                    throw std::invalid_argument("Invalid escape in JSON pointer");
+                }
+            }
+            token = unescaped;
+        }
+
+        char c = _data[pos];
+        if (c == '{') {
+            // Look at each key, jumping over the values of the others
+            pos = skip_whitespace(pos + 1);
+            if (_data[pos] == '}')
+                return not_found;
+            while (true) {
+                bool matches = key_matches(pos, token);
+                pos = skip_whitespace(skip_whitespace(pos) + 1);    // colon
+                if (matches)
+                    break;
+                pos = skip_whitespace(value_end(pos));
+                if (_data[pos] == '}')
+                    return not_found;
+                pos = skip_whitespace(pos + 1);                     // comma
+            }
+        } else if (c == '[') {
+            // Array indices are decimal numbers without leading zeros
+            if (token.empty() || token.size() > 18 || (token[0] == '0' && token.size() > 1))
+                return not_found;
+            size_t index = 0;
+            for (char digit : token) {
+                if (digit < '0' || '9' < digit)
+                    return not_found;
+                index = index * 10 + (digit - '0');
+            }
+            pos = skip_whitespace(pos + 1);
+            if (_data[pos] == ']')
+                return not_found;
+            for (; index > 0; index--) {
+                pos = skip_whitespace(value_end(pos));
+                if (_data[pos] == ']')
+                    return not_found;
+                pos = skip_whitespace(pos + 1);
+            }
+        } else {
+            // Scalars have nothing inside them
+            return not_found;
+        }
+
+        if (slash == std::string_view::npos)
+            return pos;
+        token_start = slash + 1;
+    }
+}
+
+size_t lazy::value_end(size_t pos) const {
+    // The document is known to be valid here, so values can be skipped without looking at what's inside them
+    char c = _data[pos];
+    if (c == '{' || c == '[') {
+        auto container = std::lower_bound(_containers.begin(), _containers.end(), std::make_pair(pos, (size_t) 0));
+        return container->second;
+    }
+    if (c == '"') {
+        // Strings end at the first quote that isn't escaped (preceded by an even number of backslashes)
+        const char *quote = _data + pos;
+        while (true) {
+            quote = (const char*) memchr(quote + 1, '"', _data + _size - quote - 1);
+            const char *backslash = quote;
+            while (backslash[-1] == '\\')
+                backslash--;
+            if ((quote - backslash) % 2 == 0)
+                return quote + 1 - _data;
+        }
+    }
+    while (pos < _size && !cursor::is_whitespace(_data[pos]) && _data[pos] != ',' && _data[pos] != ']' && _data[pos] != '}')
+        pos++;
+    return pos;
+}
+
+size_t lazy::skip_whitespace(size_t pos) const {
+    while (pos < _size && cursor::is_whitespace(_data[pos]))
+        pos++;
+    return pos;
+}
+
+bool lazy::key_matches(size_t &pos, std::string_view key) const {
+    size_t start = pos;
+    pos = value_end(start);
+    std::string_view text(_data + start + 1, pos - start - 2);
+    if (text.find('\\') == std::string_view::npos)
+        return text == key;
+    // Keys with escapes are compared after unescaping them
+    cursor in(_data, _data + _size);
+    in.pos = _data + start;
+    std::string unescaped;
+    in.parse_string(unescaped);
+    return unescaped == key;
+}
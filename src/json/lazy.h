@@ -0,0 +1,46 @@
+#ifndef STRTB_JSON_LAZY_H
+#define STRTB_JSON_LAZY_H
+
+#include "value.h"
+
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace strtb::json::parser {
+
+/* Lazily parsed JSON document, for when only a few values of a large document are needed.
+ * The whole buffer is validated once when it's opened (throwing invalid_json like the parser does), remembering
+ * where each array and object ends. Values are then found with JSON pointers (RFC 6901, like "/data/0/name"),
+ * by walking the raw buffer and jumping over everything in between, and only the value that was asked for is
+ * built. The buffer isn't copied, so it must stay alive as long as the document (files can be mapped with
+ * file_buffer). Duplicate keys are rejected while validating, like the parser does, so every key leads to
+ * exactly one value.
+ */
+class lazy {
+private:
+    const char *_data;
+    size_t _size;
+    size_t _root;                                       // Where the top-level value starts
+    std::vector<std::pair<size_t, size_t>> _containers; // Start and end (past the closing bracket) of each container, in order
+
+    size_t find(std::string_view pointer) const;
+    size_t value_end(size_t pos) const;
+    size_t skip_whitespace(size_t pos) const;
+    bool key_matches(size_t &pos, std::string_view key) const;
+public:
+    lazy(const char *data, size_t size);
+    lazy(const lazy&) = delete;
+    lazy& operator=(const lazy&) = delete;
+
+    // An empty pointer means the whole document. Pointers that don't start with '/' throw std::invalid_argument.
+    bool contains(std::string_view pointer) const;
+    // Text of the value in the buffer, throwing std::out_of_range if there is none
+    std::string_view raw(std::string_view pointer) const;
+    // Builds the value, in the arena if one is given, throwing std::out_of_range if there is none
+    json::value* get(std::string_view pointer, class arena *arena = nullptr) const;
+};
+
+}
+
+#endif // STRTB_JSON_LAZY_H
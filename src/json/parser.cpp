@@ -1,436 +1,220 @@
 #include "parser.h"
+#include "parser_core.h"
+#include "structural_index.h"
+#include "reader.h"
+#include "arena.h"
 #include "../logging/logging.h"
-#include "../unicode/unicode.h"
 
-#include <sstream>
-#include <locale>
-#include <limits>
 #include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+#include <system_error>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace strtb;
 using namespace strtb::json::parser;
 
-invalid_json::invalid_json(size_t line, size_t col) : _what("invalid JSON at line " + std::to_string(line) + ", col " + std::to_string(col)) {}
+invalid_json::invalid_json(size_t line, size_t col) : _what("invalid JSON at line " + std::to_string(line) + ", col " + std::to_string(col)), _line(line), _col(col) {}
 
 const char* invalid_json::what() const noexcept {return _what.c_str();}
 
+size_t invalid_json::line() const {return _line;}
+
+size_t invalid_json::col() const {return _col;}
+
 static logging::source log("JSON Parser");
 
 // Helper functions (declarations only)
-static void eat_whitespace(std::istream &stream, size_t &line, size_t &col);
-static void parse_wanted_word(std::istream &stream, const char* wanted_word, size_t &line, size_t &col);
-static json::value* parse_null(std::istream &stream, size_t &line, size_t &col);
-static json::value* parse_false(std::istream &stream, size_t &line, size_t &col);
-static json::value* parse_true(std::istream &stream, size_t &line, size_t &col);
-static json::value* parse_number(std::istream &stream, size_t &line, size_t &col);
-static json::value* parse_string(std::istream &stream, size_t &line, size_t &col);
-static json::value* parse_array(std::istream &stream, size_t &line, size_t &col);
-static json::value* parse_object(std::istream &stream, size_t &line, size_t &col);
-static json::value* parse_value(std::istream &stream, size_t &line, size_t &col);
-
-// Public functions (definitions)
-json::value* json::parser::from_stream(std::istream &stream) {
-    size_t line=1, col=1;
-    try {
-        value* val = parse_value(stream, line, col);
-        if (!stream.eof())
-            // There's extra stuff after what was parsed, meaning the file has invalid JSON
-            throw invalid_json(line, col);
-        return val;
-    } catch (std::istream::failure &e) {
-        if (stream.eof())
-            // Failure exeptions can be thrown by getting a character on EOF, in which case the JSON file ended prematurely and is invalid
-            throw invalid_json(line, col);
-        else
-            // Otherwise, it's just a general I/O error.
-            throw;
+static json::value* parse_document(reader &in, json::arena *arena);
+static json::value* build_value(reader &in, token tok, json::arena *arena);
+
+namespace {
+
+// Adds members to an object being built. Big objects with keys out of order are sorted once at the end instead
+// of inserting each member in place, with the keys tracked here meanwhile to find duplicates.
+class object_builder {
+private:
+    json::value_object *obj;
+    bool unsorted = false;
+    std::unordered_set<std::string> seen_keys;
+public:
+    object_builder(json::value_object *obj) : obj(obj) {}
+
+    // Only takes the value (returning true) if the key is new
+    bool add(const std::string &key, json::value *val) {
+        if (!unsorted && obj->size() >= 64 && std::string_view((obj->end() - 1)->first) >= key) {
+            unsorted = true;
+            for (const auto &item : *obj)
+                seen_keys.emplace(item.first);
+        }
+        if (!unsorted)
+            return obj->insert_move(key, val);
+        if (!seen_keys.insert(key).second)
+            return false;
+        obj->append_move_unsorted(key, val);
+        return true;
     }
-}
 
-json::value* json::parser::from_string(const std::string &str) {
-    std::stringstream str_stream(str, std::ios_base::in);
-    return from_stream(str_stream);
-}
+    void finish() {
+        if (unsorted)
+            obj->sort();
+    }
+};
 
-json::value* json::parser::from_file(const char* path) {
-    std::ifstream file(path, std::ifstream::in);
-    file.exceptions(std::istream::failbit | std::ifstream::badbit);
-    return from_stream(file);
 }
 
-// Helper functions (definitions)
-static void eat_whitespace(std::istream &stream, size_t &line, size_t &col) {
-    int c_prev = 0;
-    int c = stream.peek();
-    while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
-        stream.get();
-        if (c == '\r' || (c == '\n' && c_prev != '\r')) {
-            line++;
-            col = 1;
-        } else if (c != '\n') {
-            col++;
-        }
-        c_prev = c;
-        c = stream.peek();
+// Public functions (definitions)
+json::value* json::parser::from_buffer(const char *data, size_t size, class arena *arena) {
+    if (size > structural_index::max_size) {
+        // Too big to index, so read byte by byte
+        reader in(data, size);
+        return parse_document(in, arena);
     }
+    // Find all tokens in one vectorized pass first, so the reader can jump from one to the next
+    structural_index index(data, size);
+    reader in(data, size, index);
+    return parse_document(in, arena);
 }
 
-static void parse_wanted_word(std::istream &stream, const char* wanted_word, size_t &line, size_t &col) {
-    while (stream.get() == *wanted_word) {
-        // Assuming no newlines for the wanted word for line/col counting
-        col++;
-        wanted_word++;
-        if (*wanted_word == 0)
-            return;
-    }
-    throw invalid_json(line, col);
+json::value* json::parser::from_stream(std::istream &stream, class arena *arena) {
+    // Read everything first, so the buffer parser can be used
+    std::string str((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    return from_buffer(str.data(), str.size(), arena);
 }
 
-static json::value* parse_null(std::istream &stream, size_t &line, size_t &col) {
-    parse_wanted_word(stream, "null", line, col);
-    return new json::value_null();
+json::value* json::parser::from_string(const std::string &str, class arena *arena) {
+    return from_buffer(str.data(), str.size(), arena);
 }
 
-
-static json::value* parse_false(std::istream &stream, size_t &line, size_t &col) {
-    parse_wanted_word(stream, "false", line, col);
-    return new json::value_bool(false);
+json::value* json::parser::from_file(const char* path, class arena *arena) {
+    // Regular files are parsed in place
+    file_buffer file(path);
+    return from_buffer(file.data(), file.size(), arena);
 }
 
-static json::value* parse_true(std::istream &stream, size_t &line, size_t &col) {
-    parse_wanted_word(stream, "true", line, col);
-    return new json::value_bool(true);
+json::value* json::parser::from_reader(reader &in, class arena *arena) {
+    return build_value(in, in.next(), arena);
 }
 
-static json::value* parse_number(std::istream &stream, size_t &line, size_t &col) {
-    bool is_fraction = false;
-    bool is_sci_notation = false;
-    bool is_zero = false; // Excluding anything after the decimal point
-    bool is_not_zero = false; // Excluding anything after the decimal point
-    bool fraction_got_digits = false;
-    bool sci_notation_has_sign = false;
-    bool sci_notation_doesnt_have_sign = false;
-    bool sci_notation_got_digits = false;
-    bool keep_reading = true;
-    std::string number_str;
-
-    // Isolate number from input stream: Read until first invalid char or EOF
-    while (keep_reading) {
-        int c = stream.peek();
-        /* We intentionally DON'T check for read errors or EOF;
-         * the following logic needs to run first, so we can know whether
-         * the number is valid or not.
-         */
-
-        if (is_sci_notation) {                      // SCIENTIFIC NOTATION PART
-            if (!sci_notation_has_sign && !sci_notation_doesnt_have_sign) { // get at least one digit, or start with sign
-                if (c == '+' || c == '-')                   // optionally get a sign
-                    sci_notation_has_sign = true;
-                else if ('0' <= c && c <= '9') {            // start with digits, so we don't have a sign
-                    sci_notation_doesnt_have_sign = true;
-                    sci_notation_got_digits = true;
-                } else                                      // ERROR: must get at least one digit
-                    throw invalid_json(line, col);
-            } else if (!sci_notation_got_digits) {          // get at least one digit
-                if ('0' <= c && c <= '9')                   // get first digit
-                    sci_notation_got_digits = true;
-                else                                        // ERROR: must get at least one digit
-                    throw invalid_json(line, col);
-            } else if ('0' <= c && c <= '9');               // keep getting more digits
-            else                                            // number is in scientific notation
-                keep_reading = false;
-        } else if (is_fraction) {                   // FRACTION PART
-            if (fraction_got_digits) {
-                if ('0' <= c && c <= '9');                  // keep getting digits
-                else if (c == 'E' || c == 'e')              // switch to sci notation part
-                    is_sci_notation = true;
-                else                                        // number is a fraction (no sci notation)
-                    keep_reading = false;
-            } else if ('0' <= c && c <= '9')                // get at least one digit
-                fraction_got_digits = true;
-            else                                            // ERROR: must get at least one digit
-                throw invalid_json(line, col);
-        } else {                                    // INTEGER PART
-            if (number_str.empty() && c == '-');            // optional minus sign
-            else if (!is_zero && !is_not_zero) {            // get at least one digit
-                if (c == '0')                               // starts with zero (can only be 0 or 0.something)
-                    is_zero = true;
-                else if ('1' <= c && c <= '9')              // starts with other digit (can be any other number)
-                    is_not_zero = true;
-                else                                        // ERROR: must get at least one digit
-                    throw invalid_json(line, col);
-            } else if (is_not_zero && '0' <= c && c <= '9');// get more digits if NOT starting with 0
-            else if (c == '.')                              // switch to fraction part
-                is_fraction = true;
-            else if (c == 'E' || c == 'e') {                // switch to sci notation part
-                is_sci_notation = true;
-                is_fraction = true;
-            } else                                          // number is only an integer
-                keep_reading = false;
-        }
-
-        if (keep_reading) {
-            number_str.push_back(stream.get());
-            col++;
-        }
+file_buffer::file_buffer(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        throw std::ios_base::failure(std::string("Couldn't open ") + path, std::error_code(errno, std::generic_category()));
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        int error = errno;
+        close(fd);
+        throw std::ios_base::failure(std::string("Couldn't stat ") + path, std::error_code(error, std::generic_category()));
     }
 
-    if (is_fraction) {
-        /* JSON fractions always use . as the decimal point, so we need to work around
-         * the system's locale, which could use , as the decimal point.
-         */
-        double n;
-        std::stringstream str(number_str, std::ios_base::in);
-        str.imbue(std::locale("C"));
-        str >> n;
-        return new json::value_float(n);
-    } else {
-        // Try to return as an integer (long long), or if it's too big return it as a double
-        try {
-            return new json::value_int(std::stoll(number_str));
-        } catch (std::out_of_range &e) {
-            try {
-                return new json::value_float(std::stod(number_str));
-            } catch (std::out_of_range &e) {
-                // If this is also too big, just return the maximum or minimum number, based on sign
-                if (number_str[0] == '-')
-                    return new json::value_float(std::numeric_limits<double>::max());
-                else
-                    return new json::value_float(std::numeric_limits<double>::min());
-            }
-        }
+    if (S_ISREG(info.st_mode) && info.st_size > 0) {
+        // Map regular files into memory
+        size_t size = info.st_size;
+        void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        int error = errno;
+        close(fd);
+        if (data == MAP_FAILED)
+            throw std::ios_base::failure(std::string("Couldn't map ") + path, std::error_code(error, std::generic_category()));
+        madvise(data, size, MADV_SEQUENTIAL);
+        _data = (const char*) data;
+        _size = size;
+        _mapped = true;
+        return;
     }
-}
-
-static json::value* parse_string(std::istream &stream, size_t &line, size_t &col) {
-    std::string str;
-    bool escape = false;
-    int hex_pos = -1;
-    bool keep_reading = true;
-    uint32_t hex_codepoint = 0;
 
-    // Get first quotation mark
-    if (stream.get() != '"')
-        throw invalid_json(line, col);
-    col++;
-
-    // Get rest of string
-    while (keep_reading) {
-        int c = stream.get();
-
-        if (hex_pos != -1) {            // HEX ESCAPE CODE
-            uint32_t hex_digit;             // convert hex digit char to number
-            if ('0' <= c && c <= '9')
-                hex_digit = c - '0';
-            else if ('A' <= c && c <= 'F')
-                hex_digit = c - 'A' + 10;
-            else if ('a' <= c && c <= 'f')
-                hex_digit = c - 'a' + 10;
-            else
-                throw invalid_json(line, col);
-
-            hex_codepoint = hex_codepoint | (hex_digit << hex_pos);   // set appropriate bits for this hex digit
-            if (hex_pos) {
-                // Get next char
-                hex_pos -= 4;
-            } else {
-                // Hex segment finished, put unicode character into string
-                str.append(unicode::codepoint_to_utf8(hex_codepoint));
-                hex_codepoint = 0;
-                hex_pos = -1;
-            }
-        } else if (escape) {            // SIMPLE ESCAPE CODE
-            escape = false;
-            switch (c) {
-            case '"':                       // quote
-            case '\\':                      // backslash
-            case '/':                       // forward slash
-                str.push_back(c);
-                break;
-            case 'b':                       // backspace
-                str.push_back('\b');
-                break;
-            case 'f':                       // formfeed
-                str.push_back('\f');
-                break;
-            case 'n':                       // newline
-                str.push_back('\n');
-                break;
-            case 'r':                       // carriage return
-                str.push_back('\r');
-                break;
-            case 't':                       // horizontal tab
-                str.push_back('\t');
-                break;
-            case 'u':                       // hex escape code
-                hex_pos = 12;
-                break;
-            default:                        // invalid escape code
-                throw invalid_json(line, col);
-            }
-        } else {                        // REGULAR CHARACTER
-            switch (c) {
-            case '"':                       // end quote
-                keep_reading = false;
-                break;
-            case '\\':                      // escape code
-                escape = true;
-                break;
-            default:
-                if ((EOF <= c && c <= 0x1f) || c == 0x7f)   // control characters (not allowed) or premature EOF
-                    throw invalid_json(line, col);
-                else                        // regular character
-                    str.push_back(c);
-            }
+    // Anything else (empty files, pipes, etc.) is read into memory
+    char buffer[65536];
+    while (true) {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count > 0) {
+            _contents.append(buffer, count);
+        } else if (count == 0) {
+            break;
+        } else if (errno != EINTR) {
+            int error = errno;
+            close(fd);
+            throw std::ios_base::failure(std::string("Couldn't read ") + path, std::error_code(error, std::generic_category()));
         }
-
-        col++;
     }
-
-    return new json::value_string(str);
+    close(fd);
+    _data = _contents.data();
+    _size = _contents.size();
 }
 
-static json::value* parse_array(std::istream &stream, size_t &line, size_t &col) {
-    json::value_array* arr = new json::value_array();
-    bool keep_reading = true;
+file_buffer::~file_buffer() {
+    if (_mapped)
+        munmap((void*) _data, _size);
+}
 
+// Helper functions (definitions)
+static json::value* parse_document(reader &in, json::arena *arena) {
+    json::value* val = build_value(in, in.next(), arena);
     try {
-        // Read opening [
-        if (stream.get() != '[')
-            throw invalid_json(line, col);
-        col++;
-        eat_whitespace(stream, line, col);
-
-        // Check for closing ] (which means the array is empty)
-        if (stream.peek() == ']') {
-            keep_reading = false;
-            stream.get();
-            col++;
-        }
-
-        // Read all values and closing ]
-        while (keep_reading) {
-            // Get value
-            arr->push_back_move(parse_value(stream, line, col));
-
-            switch (stream.get()) {
-            case ',':   // comma => more values to get after this
-                break;
-            case ']':   // square bracket => end of array
-                keep_reading = false;
-                break;
-            default:    // invalid character
-                throw invalid_json(line, col);
-            }
-            col++;
-        }
+        // There must be nothing but whitespace after the document
+        in.next();
     } catch (...) {
-        // Clear used memory before passing on the exception
-        delete arr;
+        json::value_utils::release(val);
         throw;
     }
-
-    return arr;
+    return val;
 }
 
-static json::value* parse_object(std::istream &stream, size_t &line, size_t &col) {
-    json::value_object* obj = new json::value_object();
-    bool keep_reading = true;
-
-    try {
-        // Read opening {
-        if (stream.get() != '{')
-            throw invalid_json(line, col);
-        col++;
-        eat_whitespace(stream, line, col);
-
-        // Check for closing } (which means the object is empty)
-        if (stream.peek() == '}') {
-            keep_reading = false;
-            stream.get();
-            col++;
+static json::value* build_value(reader &in, token tok, json::arena *arena) {
+    switch (tok) {
+    case TOKEN_NULL:
+        return json::make<json::value_null>(arena);
+    case TOKEN_BOOL:
+        return json::make<json::value_bool>(arena, in.bool_value());
+    case TOKEN_INT:
+        return json::make<json::value_int>(arena, in.int_value());
+    case TOKEN_FLOAT:
+        return json::make<json::value_float>(arena, in.float_value());
+    case TOKEN_STRING:
+        return json::make<json::value_string>(arena, std::string_view(in.string_value()));
+
+    case TOKEN_START_ARRAY: {
+        json::value_array* arr = json::make<json::value_array>(arena);
+        try {
+            while ((tok = in.next()) != TOKEN_END_ARRAY)
+                arr->push_back_move(build_value(in, tok, arena));
+        } catch (...) {
+            // Clear used memory before passing on the exception
+            json::value_utils::release(arr);
+            throw;
         }
+        return arr;
+    }
 
-        // Read all key-value pairs and closing }
-        while (keep_reading) {
-            // Key
-            eat_whitespace(stream, line, col);
-            size_t line_pre_key = line, col_pre_key = col;
-            json::value_string* key_obj = (json::value_string*) parse_string(stream, line, col);
-            std::string key = key_obj->value();
-            delete key_obj;
-            if (obj->exists(key))   // Make sure it doesn't already exist
-                throw invalid_json(line_pre_key, col_pre_key);
-            eat_whitespace(stream, line, col);
-
-            // Colon separator
-            if (stream.get() != ':')
-                throw invalid_json(line, col);
-            col++;
-
-            // Value
-            obj->set_move(key, parse_value(stream, line, col));
-
-            // Comma or closing }
-            switch (stream.get()) {
-            case ',':   // comma => more key/value pairs after this
-                break;
-            case '}':   // curly bracket => end of object
-                keep_reading = false;
-                break;
-            default:    // invalid character
-                throw invalid_json(line, col);
+    case TOKEN_START_OBJECT: {
+        json::value_object* obj = json::make<json::value_object>(arena);
+        object_builder builder(obj);
+        std::string key;
+        try {
+            // Members always start with a key
+            while (in.next() != TOKEN_END_OBJECT) {
+                key = in.string_value();
+                size_t key_offset = in.token_offset();
+                json::value* val = build_value(in, in.next(), arena);
+                if (!builder.add(key, val)) {
+                    json::value_utils::release(val);
+                    in.fail_at(key_offset);
+                }
             }
-            col++;
+            builder.finish();
+        } catch (...) {
+            // Clear used memory before passing on the exception
+            json::value_utils::release(obj);
+            throw;
         }
-    } catch (...) {
-        // Clear used memory before passing on the exception
-        delete obj;
-        throw;
+        return obj;
     }
 
-    return obj;
-}
-
-static json::value* parse_value(std::istream &stream, size_t &line, size_t &col) {
-    json::value* val;
-    eat_whitespace(stream, line, col);
-
-    // Decide what kind of value it is
-    int c = stream.peek();
-    switch (c) {
-    case 'n':       // null
-        val = parse_null(stream, line, col);
-        break;
-    case 'f':       // false
-        val = parse_false(stream, line, col);
-        break;
-    case 't':       // true
-        val = parse_true(stream, line, col);
-        break;
-    case '[':       // array
-        val = parse_array(stream, line, col);
-        break;
-    case '{':       // object
-        val = parse_object(stream, line, col);
-        break;
-    case '"':       // string
-        val = parse_string(stream, line, col);
-        break;
     default:
-        if (c == '-' || ('0' <= c && c <= '9'))     // number
-            val = parse_number(stream, line, col);
-        else        // invalid character
-            throw invalid_json(line, col);
-    }
-
-    try {
-        eat_whitespace(stream, line, col);
-    } catch (...) {
-        // On exception, delete the object we created before rethrowing
-        delete val;
-        throw;
+        throw std::logic_error("JSON reader isn't in front of a value");
     }
-
-    return val;
 }
@@ -8,17 +8,44 @@
 
 namespace strtb::json::parser {
 
+class reader;
+
 class invalid_json : public std::exception {
 private:
     std::string _what;
+    size_t _line, _col;
 public:
     invalid_json(size_t line, size_t col);
     const char* what() const noexcept;
+    size_t line() const;
+    size_t col() const;
 };
 
-json::value* from_stream(std::istream &stream);
-json::value* from_string(const std::string &str);
-json::value* from_file(const char* path);
+// Parsed values are put in the given arena if there is one (and must not be deleted then), or on the heap otherwise
+json::value* from_buffer(const char *data, size_t size, class arena *arena = nullptr);
+json::value* from_stream(std::istream &stream, class arena *arena = nullptr);
+json::value* from_string(const std::string &str, class arena *arena = nullptr);
+json::value* from_file(const char* path, class arena *arena = nullptr);
+// Builds the next value of a reader, which must not be in front of a key (it's left right after the value)
+json::value* from_reader(reader &in, class arena *arena = nullptr);
+
+/* Contents of a file in one buffer. Regular files are mapped into memory (so they take no heap memory),
+ * and anything else (pipes etc.) is read in.
+ */
+class file_buffer {
+private:
+    const char *_data = nullptr;
+    size_t _size = 0;
+    bool _mapped = false;
+    std::string _contents;
+public:
+    file_buffer(const char *path);
+    ~file_buffer();
+    file_buffer(const file_buffer&) = delete;
+    file_buffer& operator=(const file_buffer&) = delete;
+    const char* data() const {return _data;}
+    size_t size() const {return _size;}
+};
 
 }
 
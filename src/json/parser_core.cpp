@@ -0,0 +1,249 @@
+#include "parser_core.h"
+#include "parser.h"
+#include "../unicode/unicode.h"
+
+#include <charconv>
+#include <limits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace strtb;
+using namespace strtb::json::parser;
+
+void cursor::fail() const {
+    fail_at(this->pos);
+}
+
+void cursor::fail_at(const char *where) const {
+    // Count lines and columns up to the error (CR, LF and CRLF all count as one line break)
+    size_t line = 1, col = 1;
+    for (const char *c = this->begin; c < where; c++) {
+        if (*c == '\r' || (*c == '\n' && (c == this->begin || c[-1] != '\r'))) {
+            line++;
+            col = 1;
+        } else if (*c != '\n') {
+            col++;
+        }
+    }
+    throw invalid_json(line, col);
+}
+
+void cursor::expect_word(const char *word) {
+    for (; *word; word++) {
+        if (this->peek() != (unsigned char) *word)
+            this->fail();
+        this->pos++;
+    }
+}
+
+static inline const char* find_special(const char *pos, const char *end) {
+    // Finds the first byte that can't be copied into a string as-is: quotes, backslashes and control characters
+#if defined(__x86_64__)
+    const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\'), del = _mm_set1_epi8(0x7f),
+                  control = _mm_set1_epi8(0x1f);
+    for (; pos + 16 <= end; pos += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) pos);
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, del), _mm_cmpeq_epi8(_mm_max_epu8(v, control), control)));
+        int mask = _mm_movemask_epi8(special);
+        if (mask)
+            return pos + __builtin_ctz(mask);
+    }
+#endif
+    for (; pos < end; pos++) {
+        unsigned char c = *pos;
+        if (c == '"' || c == '\\' || c <= 0x1f || c == 0x7f)
+            return pos;
+    }
+    return end;
+}
+
+uint32_t cursor::parse_hex4() {
+    uint32_t codepoint = 0;
+    for (int i=0; i<4; i++) {
+        int c = this->peek();
+        uint32_t hex_digit;             // convert hex digit char to number
+        if ('0' <= c && c <= '9')
+            hex_digit = c - '0';
+        else if ('A' <= c && c <= 'F')
+            hex_digit = c - 'A' + 10;
+        else if ('a' <= c && c <= 'f')
+            hex_digit = c - 'a' + 10;
+        else
+            this->fail();
+        codepoint = (codepoint << 4) | hex_digit;
+        this->pos++;
+    }
+    return codepoint;
+}
+
+void cursor::parse_string(std::string &out) {
+    // Get first quotation mark
+    if (this->peek() != '"')
+        this->fail();
+
+    if (this->next && this->begin + *this->next == this->pos) {
+        // With an index, the closing quote is the last non-whitespace byte before the next token.
+        // If there's nothing to unescape or reject in between, the whole string can be copied at once.
+        const char *close = this->begin + this->next[1];
+        while (close > this->pos + 1 && cursor::is_whitespace(close[-1]))
+            close--;
+        close--;
+        if (close > this->pos && *close == '"' && find_special(this->pos + 1, close) == close) {
+            out.append(this->pos + 1, close);
+            this->pos = close + 1;
+            this->next++;
+            return;
+        }
+    }
+    this->pos++;
+
+    // Get rest of string
+    while (true) {
+        // Copy everything up to the next special character in one go
+        const char *special = find_special(this->pos, this->end);
+        out.append(this->pos, special);
+        this->pos = special;
+
+        int c = this->peek();
+        if (c == '"') {                     // end quote
+            this->pos++;
+            return;
+        } else if (c != '\\') {            // control characters (not allowed) or premature EOF
+            this->fail();
+        }
+
+        // Escape code
+        this->pos++;
+        switch (this->peek()) {
+        case '"':                       // quote
+        case '\\':                      // backslash
+        case '/':                       // forward slash
+            out.push_back(*this->pos);
+            break;
+        case 'b':                       // backspace
+            out.push_back('\b');
+            break;
+        case 'f':                       // formfeed
+            out.push_back('\f');
+            break;
+        case 'n':                       // newline
+            out.push_back('\n');
+            break;
+        case 'r':                       // carriage return
+            out.push_back('\r');
+            break;
+        case 't':                       // horizontal tab
+            out.push_back('\t');
+            break;
+        case 'u': {                     // hex escape code
+            this->pos++;
+            uint32_t codepoint = this->parse_hex4();
+            if (0xD800 <= codepoint && codepoint <= 0xDBFF && this->end - this->pos >= 2 && this->pos[0] == '\\' && this->pos[1] == 'u') {
+                // High surrogate followed by another hex escape, which should be the low half of the pair
+                const char *second = this->pos;
+                this->pos += 2;
+                uint32_t low = this->parse_hex4();
+                if (0xDC00 <= low && low <= 0xDFFF)
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                else
+                    this->pos = second;     // Not a pair, so the second escape is handled on its own
+            }
+            // Unpaired surrogates become U+FFFD
+            char utf8[4];
+            out.append(utf8, unicode::encode_utf8(codepoint, utf8));
+            continue;
+        }
+        default:                        // invalid escape code
+            this->fail();
+        }
+        this->pos++;
+    }
+}
+
+static double out_of_range(const char *start, const char *end) {
+    // from_chars doesn't tell us which way a number went out of range, so work out its rough decimal magnitude:
+    // significant integer digits, minus the leading zeros of the fraction if there are none, plus the exponent
+    bool negative = *start == '-';
+    const char *c = start + negative;
+    long long magnitude = 0;
+    if (*c == '0') {
+        c++;
+        if (c < end && *c == '.')
+            for (c++; c < end && *c == '0'; c++)
+                magnitude--;
+    } else {
+        for (; c < end && '0' <= *c && *c <= '9'; c++)
+            magnitude++;
+    }
+    while (c < end && *c != 'e' && *c != 'E')
+        c++;
+    if (c < end) {
+        c++;
+        bool negative_exponent = *c == '-';
+        if (*c == '+' || *c == '-')
+            c++;
+        long long exponent = 0;
+        for (; c < end && exponent < 1000000000; c++)    // Anything this big is out of range either way
+            exponent = exponent * 10 + (*c - '0');
+        magnitude += negative_exponent ? -exponent : exponent;
+    }
+
+    // Too big becomes the largest number with the same sign, too small becomes zero
+    if (magnitude > 0)
+        return negative ? std::numeric_limits<double>::lowest() : std::numeric_limits<double>::max();
+    else
+        return negative ? -0.0 : 0.0;
+}
+
+number cursor::parse_number() {
+    const char *start = this->pos;
+    bool is_fraction = false;
+
+    // Optional minus sign, then at least one digit (no leading zeros)
+    if (this->peek() == '-')
+        this->pos++;
+    int c = this->peek();
+    if (c == '0')
+        this->pos++;
+    else if ('1' <= c && c <= '9')
+        while ('0' <= this->peek() && this->peek() <= '9')
+            this->pos++;
+    else
+        this->fail();
+    // Fraction part, with at least one digit
+    if (this->peek() == '.') {
+        is_fraction = true;
+        this->pos++;
+        if (!('0' <= this->peek() && this->peek() <= '9'))
+            this->fail();
+        while ('0' <= this->peek() && this->peek() <= '9')
+            this->pos++;
+    }
+    // Scientific notation part, with an optional sign and at least one digit
+    if (this->peek() == 'e' || this->peek() == 'E') {
+        is_fraction = true;
+        this->pos++;
+        if (this->peek() == '+' || this->peek() == '-')
+            this->pos++;
+        if (!('0' <= this->peek() && this->peek() <= '9'))
+            this->fail();
+        while ('0' <= this->peek() && this->peek() <= '9')
+            this->pos++;
+    }
+
+    // std::from_chars always uses . as the decimal point and never throws, whatever the system's locale is
+    if (!is_fraction) {
+        long long integer;
+        if (std::from_chars(start, this->pos, integer).ec == std::errc())
+            return {false, integer, 0};
+        // Too big for an integer, so it has to be returned as a double
+    }
+    double fraction;
+    if (std::from_chars(start, this->pos, fraction).ec == std::errc())
+        return {true, 0, fraction};
+    return {true, 0, out_of_range(start, this->pos)};
+}
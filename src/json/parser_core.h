@@ -0,0 +1,63 @@
+#ifndef STRTB_JSON_PARSER_CORE_H
+#define STRTB_JSON_PARSER_CORE_H
+
+#include <string>
+#include <cstdio>
+#include <cstdint>
+
+namespace strtb::json::parser {
+
+struct number {
+    bool is_fraction;   // Had a fraction or exponent part, or was too big for an integer
+    long long integer;
+    double fraction;
+};
+
+/* Reads JSON tokens directly from a contiguous buffer, without copying it.
+ * This is shared by all parser front-ends. Only the byte offset is tracked while parsing;
+ * line and column are worked out from it when an error is reported.
+ * If a structural index of the buffer is given, whitespace is skipped by jumping to the next indexed token.
+ */
+class cursor {
+public:
+    const char *const begin, *const end;
+    const char *pos;
+    const uint32_t *next = nullptr;     // First indexed token at or after pos (nullptr without an index)
+
+    cursor(const char *begin, const char *end) : begin(begin), end(end), pos(begin) {}
+    cursor(const char *begin, const char *end, const uint32_t *index) : begin(begin), end(end), pos(begin), next(index) {}
+
+    static bool is_whitespace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+    int peek() const {
+        return pos < end ? (unsigned char) *pos : EOF;
+    }
+    int get() {
+        return pos < end ? (unsigned char) *pos++ : EOF;
+    }
+    void skip_whitespace() {
+        if (next) {
+            // Anything non-whitespace that follows whitespace is indexed, so if we're at whitespace,
+            // everything up to the next token is whitespace too (we only stay put at garbage, so it gets reported)
+            while (begin + *next < pos)
+                next++;
+            if (pos < begin + *next && is_whitespace(*pos))
+                pos = begin + *next;
+            return;
+        }
+        while (pos < end && is_whitespace(*pos))
+            pos++;
+    }
+
+    [[noreturn]] void fail() const;
+    [[noreturn]] void fail_at(const char *where) const;
+    void expect_word(const char *word);
+    uint32_t parse_hex4();
+    void parse_string(std::string &out);
+    number parse_number();
+};
+
+}
+
+#endif // STRTB_JSON_PARSER_CORE_H
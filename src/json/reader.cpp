@@ -0,0 +1,125 @@
+#include "reader.h"
+#include "structural_index.h"
+
+using namespace strtb;
+using namespace strtb::json::parser;
+
+reader::reader(const char *data, size_t size) : in(data, data + size), _token_pos(data) {}
+
+reader::reader(const char *data, size_t size, const structural_index &index) : in(data, data + size, index.get_positions()), _token_pos(data) {}
+
+token reader::next() {
+    in.skip_whitespace();
+    _token_pos = in.pos;
+
+    switch (_state) {
+    case STATE_VALUE:           // after a colon, or at the start of the document
+        return read_value();
+
+    case STATE_FIRST_ITEM:      // right after [
+        if (in.peek() == ']')
+            return end_container();
+        return read_value();
+
+    case STATE_FIRST_MEMBER:    // right after {
+        if (in.peek() == '}')
+            return end_container();
+        return read_key();
+
+    case STATE_AFTER_VALUE:
+        if (_containers.empty()) {
+            // There must be nothing but whitespace after the document
+            if (in.pos != in.end)
+                in.fail();
+            _state = STATE_DONE;
+            return _last = TOKEN_END;
+        }
+        if (in.peek() == ',') {     // comma => another item or member
+            in.pos++;
+            in.skip_whitespace();
+            _token_pos = in.pos;
+            if (_containers.back() == '{')
+                return read_key();
+            return read_value();
+        }
+        if (in.peek() == (_containers.back() == '{' ? '}' : ']'))
+            return end_container();
+        in.fail();
+
+    default:
+        return _last = TOKEN_END;
+    }
+}
+
+void reader::skip() {
+    if (_last != TOKEN_START_ARRAY && _last != TOKEN_START_OBJECT)
+        return;
+    size_t target = depth() - 1;
+    while (depth() > target)
+        next();
+}
+
+void reader::fail_at(size_t offset) const {in.fail_at(in.begin + offset);}
+
+token reader::read_value() {
+    int c = in.peek();
+    _state = STATE_AFTER_VALUE;
+    switch (c) {
+    case 'n':       // null
+        in.expect_word("null");
+        return _last = TOKEN_NULL;
+    case 'f':       // false
+        in.expect_word("false");
+        _bool = false;
+        return _last = TOKEN_BOOL;
+    case 't':       // true
+        in.expect_word("true");
+        _bool = true;
+        return _last = TOKEN_BOOL;
+    case '[':       // array
+        in.pos++;
+        _containers.push_back('[');
+        _state = STATE_FIRST_ITEM;
+        return _last = TOKEN_START_ARRAY;
+    case '{':       // object
+        in.pos++;
+        _containers.push_back('{');
+        _state = STATE_FIRST_MEMBER;
+        return _last = TOKEN_START_OBJECT;
+    case '"':       // string
+        _string.clear();
+        in.parse_string(_string);
+        return _last = TOKEN_STRING;
+    default:
+        if (c == '-' || ('0' <= c && c <= '9')) {   // number
+            number n = in.parse_number();
+            if (n.is_fraction) {
+                _float = n.fraction;
+                return _last = TOKEN_FLOAT;
+            }
+            _int = n.integer;
+            return _last = TOKEN_INT;
+        }
+        in.fail();  // invalid character
+    }
+}
+
+token reader::read_key() {
+    _string.clear();
+    in.parse_string(_string);
+    in.skip_whitespace();
+    // Colon separator
+    if (in.peek() != ':')
+        in.fail();
+    in.pos++;
+    _state = STATE_VALUE;
+    return _last = TOKEN_KEY;
+}
+
+token reader::end_container() {
+    in.pos++;
+    char bracket = _containers.back();
+    _containers.pop_back();
+    _state = STATE_AFTER_VALUE;
+    return _last = (bracket == '{' ? TOKEN_END_OBJECT : TOKEN_END_ARRAY);
+}
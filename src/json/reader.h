@@ -0,0 +1,67 @@
+#ifndef STRTB_JSON_READER_H
+#define STRTB_JSON_READER_H
+
+#include "parser_core.h"
+
+#include <string>
+#include <vector>
+
+namespace strtb::json::parser {
+
+class structural_index;
+
+enum token {TOKEN_END, TOKEN_NULL, TOKEN_BOOL, TOKEN_INT, TOKEN_FLOAT, TOKEN_STRING, TOKEN_KEY,
+            TOKEN_START_ARRAY, TOKEN_END_ARRAY, TOKEN_START_OBJECT, TOKEN_END_OBJECT};
+
+/* Pull-based JSON reader. Each call to next() reads one token of the document and returns its type, with the
+ * value of scalars and keys available until the next call. Nothing is kept besides the current token and the
+ * kind of each container we're in, so documents of any size can be walked in constant memory (files can be
+ * mapped with file_buffer). Duplicate keys aren't detected, since that would mean remembering every key.
+ * The whole document is validated as it's read, and errors are reported with invalid_json like the parser does.
+ * parser::from_reader() builds values out of parts of the document.
+ */
+class reader {
+private:
+    enum state {STATE_VALUE, STATE_FIRST_ITEM, STATE_FIRST_MEMBER, STATE_AFTER_VALUE, STATE_DONE};
+
+    cursor in;
+    std::vector<char> _containers;  // Opening bracket of each container we're in
+    state _state = STATE_VALUE;
+    token _last = TOKEN_END;
+    const char *_token_pos;
+    bool _bool = false;
+    long long _int = 0;
+    double _float = 0;
+    std::string _string;
+
+    token read_value();
+    token read_key();
+    token end_container();
+public:
+    reader(const char *data, size_t size);
+    // Jumps over whitespace with a structural index of the same buffer, which has to outlive the reader
+    reader(const char *data, size_t size, const structural_index &index);
+    reader(const reader&) = delete;
+    reader& operator=(const reader&) = delete;
+
+    // Reads the next token, or returns TOKEN_END after the document is over
+    token next();
+    // Skips the rest of the array or object that was just started (and does nothing after other tokens)
+    void skip();
+
+    // Value of the last token, for the types that have one (strings and keys both use string_value())
+    bool bool_value() const {return _bool;}
+    long long int_value() const {return _int;}
+    double float_value() const {return _float;}
+    const std::string& string_value() const {return _string;}
+
+    // Number of arrays and objects the reader is currently in
+    size_t depth() const {return _containers.size();}
+    // Where the last token started, in bytes from the start of the document
+    size_t token_offset() const {return _token_pos - in.begin;}
+    [[noreturn]] void fail_at(size_t offset) const;
+};
+
+}
+
+#endif // STRTB_JSON_READER_H
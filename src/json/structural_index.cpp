@@ -0,0 +1,229 @@
+#include "structural_index.h"
+
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+using namespace strtb;
+using namespace strtb::json::parser;
+
+namespace {
+
+// One bit per byte of a 64-byte block, for each class of character we care about
+struct block_masks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t whitespace;
+    uint64_t op;            // {}[]:,
+};
+
+// What carries over from one block to the next
+struct scan_state {
+    uint64_t escaped = 0;       // First byte of the next block is escaped by a backslash
+    uint64_t in_string = 0;     // All ones while inside a string
+    uint64_t scalar = 0;        // Previous block ended in the middle of a non-whitespace run
+};
+
+enum char_class : uint8_t {
+    CLASS_OTHER = 0,
+    CLASS_QUOTE,
+    CLASS_BACKSLASH,
+    CLASS_WHITESPACE,
+    CLASS_OP
+};
+
+struct class_table {
+    uint8_t classes[256] = {};
+    constexpr class_table() {
+        classes[(unsigned char) '"'] = CLASS_QUOTE;
+        classes[(unsigned char) '\\'] = CLASS_BACKSLASH;
+        for (char c : {' ', '\t', '\n', '\r'})
+            classes[(unsigned char) c] = CLASS_WHITESPACE;
+        for (char c : {'{', '}', '[', ']', ':', ','})
+            classes[(unsigned char) c] = CLASS_OP;
+    }
+};
+
+constexpr class_table char_classes;
+
+}
+
+static inline block_masks classify_scalar(const char *block) {
+    block_masks masks = {};
+    for (int i=0; i<64; i++) {
+        uint64_t bit = 1ULL << i;
+        switch (char_classes.classes[(unsigned char) block[i]]) {
+        case CLASS_QUOTE:
+            masks.quote |= bit;
+            break;
+        case CLASS_BACKSLASH:
+            masks.backslash |= bit;
+            break;
+        case CLASS_WHITESPACE:
+            masks.whitespace |= bit;
+            break;
+        case CLASS_OP:
+            masks.op |= bit;
+            break;
+        }
+    }
+    return masks;
+}
+
+#if defined(__x86_64__)
+static inline block_masks classify_sse2(const char *block) {
+    block_masks masks = {};
+    for (int i=0; i<4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i*) (block + i * 16));
+        // { and [ (and } and ]) only differ in bit 5, so both pairs can be found with one comparison each
+        __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i quote = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+        __m128i backslash = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+        __m128i whitespace = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+        __m128i op = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+        int shift = i * 16;
+        masks.quote |= (uint64_t) (uint16_t) _mm_movemask_epi8(quote) << shift;
+        masks.backslash |= (uint64_t) (uint16_t) _mm_movemask_epi8(backslash) << shift;
+        masks.whitespace |= (uint64_t) (uint16_t) _mm_movemask_epi8(whitespace) << shift;
+        masks.op |= (uint64_t) (uint16_t) _mm_movemask_epi8(op) << shift;
+    }
+    return masks;
+}
+
+__attribute__((target("avx2")))
+static inline block_masks classify_avx2(const char *block) {
+    block_masks masks = {};
+    for (int i=0; i<2; i++) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (block + i * 32));
+        __m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i quote = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'));
+        __m256i backslash = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'));
+        __m256i whitespace = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+        __m256i op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+        int shift = i * 32;
+        masks.quote |= (uint64_t) (uint32_t) _mm256_movemask_epi8(quote) << shift;
+        masks.backslash |= (uint64_t) (uint32_t) _mm256_movemask_epi8(backslash) << shift;
+        masks.whitespace |= (uint64_t) (uint32_t) _mm256_movemask_epi8(whitespace) << shift;
+        masks.op |= (uint64_t) (uint32_t) _mm256_movemask_epi8(op) << shift;
+    }
+    return masks;
+}
+#endif
+
+static inline uint64_t prefix_xor(uint64_t bits) {
+    // Each bit becomes the XOR of itself and all bits below it
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+static inline uint64_t find_tokens(const block_masks &masks, scan_state &state) {
+    // Work out which bytes are escaped. Backslashes are rare, so they're just walked one by one.
+    uint64_t backslash = masks.backslash & ~state.escaped;
+    uint64_t escaped = state.escaped;
+    state.escaped = 0;
+    while (backslash) {
+        int i = __builtin_ctzll(backslash);
+        if (i == 63) {
+            state.escaped = 1;
+            break;
+        }
+        escaped |= 2ULL << i;
+        // The escaped byte can't escape anything itself, even if it's a backslash
+        backslash &= ~(3ULL << i);
+    }
+
+    // Bytes from an opening quote up to (but not including) its closing quote are inside the string
+    uint64_t quote = masks.quote & ~escaped;
+    uint64_t in_string = prefix_xor(quote) ^ state.in_string;
+    state.in_string = (uint64_t) ((int64_t) in_string >> 63);
+
+    // Runs of anything else outside strings are scalars (or garbage), and only their first byte is a token
+    uint64_t outside = ~in_string;
+    uint64_t scalar = outside & ~(masks.op | masks.whitespace | quote);
+    uint64_t scalar_start = scalar & ~((scalar << 1) | state.scalar);
+    state.scalar = scalar >> 63;
+
+    return (masks.op & outside) | (quote & in_string) | scalar_start;
+}
+
+static inline uint32_t* write_positions(uint64_t tokens, uint32_t base, uint32_t *out) {
+    while (tokens) {
+        *out++ = base + __builtin_ctzll(tokens);
+        tokens &= tokens - 1;
+    }
+    return out;
+}
+
+template<block_masks (*classify)(const char*)>
+static inline __attribute__((always_inline)) size_t index_buffer(const char *data, size_t size, uint32_t *positions) {
+    scan_state state;
+    uint32_t *out = positions;
+    size_t offset = 0;
+    for (; offset + 64 <= size; offset += 64)
+        out = write_positions(find_tokens(classify(data + offset), state), offset, out);
+    if (offset < size) {
+        // Pad the last partial block with whitespace, which never adds tokens
+        char block[64];
+        memset(block, ' ', sizeof(block));
+        memcpy(block, data + offset, size - offset);
+        out = write_positions(find_tokens(classify(block), state), offset, out);
+    }
+    return out - positions;
+}
+
+#if defined(__x86_64__)
+static size_t index_sse2(const char *data, size_t size, uint32_t *positions) {
+    return index_buffer<classify_sse2>(data, size, positions);
+}
+
+__attribute__((target("avx2")))
+static size_t index_avx2(const char *data, size_t size, uint32_t *positions) {
+    return index_buffer<classify_avx2>(data, size, positions);
+}
+#else
+static size_t index_scalar(const char *data, size_t size, uint32_t *positions) {
+    return index_buffer<classify_scalar>(data, size, positions);
+}
+#endif
+
+static size_t index_any(const char *data, size_t size, uint32_t *positions) {
+    // Pick the widest implementation the CPU supports, once
+    static size_t (*const impl)(const char*, size_t, uint32_t*) = []() {
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return index_avx2;
+        return index_sse2;
+#else
+        return index_scalar;
+#endif
+    }();
+    return impl(data, size, positions);
+}
+
+structural_index::structural_index(const char *data, size_t size) {
+    // Every byte could be a token in the worst case, plus the end marker. Most of this is never touched in practice.
+    this->positions = new uint32_t[size + 1];
+    this->count = index_any(data, size, this->positions);
+    this->positions[this->count] = size;
+}
+
+structural_index::~structural_index() {
+    delete[] this->positions;
+}
@@ -0,0 +1,34 @@
+#ifndef STRTB_JSON_STRUCTURAL_INDEX_H
+#define STRTB_JSON_STRUCTURAL_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace strtb::json::parser {
+
+/* Offsets of every token start in a JSON buffer: structural characters ({}[]:,), opening quotes of strings,
+ * and the first byte of every other run of non-whitespace (numbers, literals and garbage).
+ * Nothing inside strings is listed, so the parser can jump from token to token instead of looking at every byte.
+ * The buffer is classified in 64-byte blocks with SSE2/AVX2 where available, and with plain C++ otherwise.
+ * The list ends with the size of the buffer, so there's always a next position to jump to.
+ */
+class structural_index {
+private:
+    uint32_t *positions;
+    size_t count;
+public:
+    // Buffers past this size can't be indexed with 32-bit offsets, and are parsed without an index
+    static const size_t max_size = UINT32_MAX - 1;
+
+    structural_index(const char *data, size_t size);
+    ~structural_index();
+    structural_index(const structural_index &) = delete;
+    structural_index& operator=(const structural_index &) = delete;
+
+    const uint32_t* get_positions() const {return positions;}
+    size_t size() const {return count;}
+};
+
+}
+
+#endif // STRTB_JSON_STRUCTURAL_INDEX_H
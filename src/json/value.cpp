@@ -1,28 +1,58 @@
 #include "value.h"
-#include <fstream>
-#include <sstream>
+#include "writer.h"
+#include <system_error>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace strtb;
 using namespace strtb::json;
 
 const char* invalid_type::what() const noexcept {return "invalid or unwanted json value type";}
 
-value::value(val_type type) : _type(type) {}
+value::value(val_type type, class arena *arena) : _type(type), _arena(arena) {}
+
+value::value(const value &from) : _type(from._type), _arena(nullptr) {}
+
+value& value::operator=(const value &) {return *this;}
+
+value* value::copy() const {return copy_into(nullptr);}
 
 val_type value::type() const {return this->_type;}
 
+bool value::in_arena() const {return this->_arena != nullptr;}
+
+class arena* value::get_arena() const {return this->_arena;}
+
+void value::write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline) const {
+    writer out(stream, pretty_print, newline, pretty_print_level);
+    out.write(*this);
+    out.flush();
+}
+
 void value::write_to_stream(std::ostream &stream, int pretty_print, const char* newline) const {
     write_to_stream(stream, pretty_print, 0, newline);
 }
 
 void value::write_to_file(const char *path, int pretty_print, const char* newline) const {
-    std::ofstream output_file(path, std::ofstream::out);
-    output_file.exceptions(std::ofstream::failbit | std::ofstream::badbit);
-    write_to_stream(output_file, pretty_print, 0, newline);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+        throw std::ios_base::failure(std::string("Couldn't open ") + path, std::error_code(errno, std::generic_category()));
+    try {
+        writer out(fd, pretty_print, newline);
+        out.write(*this);
+        out.flush();
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    if (close(fd) != 0)
+        throw std::ios_base::failure(std::string("Couldn't close ") + path, std::error_code(errno, std::generic_category()));
 }
 
 std::string value::write_to_string(int pretty_print, const char* newline) const {
-    std::stringstream str_stream(std::ios_base::out);
-    write_to_stream(str_stream, pretty_print, 0, newline);
-    return str_stream.str();
+    std::string str;
+    writer out(str, pretty_print, newline);
+    out.write(*this);
+    return str;
 }
@@ -7,6 +7,8 @@
 
 namespace strtb::json {
 
+class arena;
+
 enum val_type {VAL_NULL, VAL_BOOL, VAL_INT, VAL_FLOAT, VAL_STRING, VAL_ARRAY, VAL_OBJECT, VAL_UNDEFINED};
 
 class invalid_type : public std::exception {
@@ -17,13 +19,20 @@ public:
 class value {
 private:
     val_type _type;
+    class arena *_arena;
 protected:
-    value(val_type type);
+    value(val_type type, class arena *arena = nullptr);
+    // Copies are made outside of any arena, and assigning to a value keeps it where it is
+    value(const value &from);
+    value& operator=(const value &from);
 public:
-    virtual value* copy() const = 0;
+    value* copy() const;
+    virtual value* copy_into(class arena *arena) const = 0;
     virtual ~value() = default;
     val_type type() const;
-    virtual void write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline = "\n") const = 0;
+    bool in_arena() const;
+    class arena* get_arena() const;     // Arena the value is in, or nullptr on the heap
+    void write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline = "\n") const;
     void write_to_stream(std::ostream &stream, int pretty_print = 0, const char* newline = "\n") const;
     void write_to_file(const char *path, int pretty_print = 0, const char* newline = "\n") const;
     std::string write_to_string(int pretty_print = 0, const char* newline = "\n") const;
@@ -1,18 +1,68 @@
 #include "value_array.h"
+#include "arena.h"
 #include <stdexcept>
 
 using namespace strtb;
 using namespace strtb::json;
 
-value_array::value_array() : json::value(VAL_ARRAY) {}
+value_array::value_array() : json::value(VAL_ARRAY), _contents(arena::resource(nullptr)) {}
 
-value_array::value_array(const std::vector<value*> &contents) : json::value(VAL_ARRAY) {set_contents(contents);}
+value_array::value_array(const std::vector<value*> &contents) : value_array() {set_contents(contents);}
 
-value_array::value_array(const value_array &from) : value_array(from._contents) {};
+value_array::value_array(std::vector<value*> &&contents) : value_array() {set_contents(std::move(contents));}
+
+value_array::value_array(const value_array &from) : value_array() {
+    _contents.reserve(from._contents.size());
+    for (auto item : from._contents)
+        _contents.push_back(item->copy());
+}
+
+value_array::value_array(value_array &&from) : value_array() {*this = std::move(from);}
+
+value_array::value_array(class arena *arena) : json::value(VAL_ARRAY, arena), _contents(arena::resource(arena)) {}
+
+value_array::value_array(class arena *arena, const std::vector<value*> &contents) : value_array(arena) {set_contents(contents);}
+
+value_array::value_array(class arena *arena, std::vector<value*> &&contents) : value_array(arena) {set_contents(std::move(contents));}
 
 value_array::~value_array() {
-    for (auto v : _contents)
-        delete v;
+    // Values in an arena are freed along with it
+    if (!in_arena())
+        for (auto v : _contents)
+            delete v;
+}
+
+value_array& value_array::operator=(const value_array &from) {
+    if (this != &from) {
+        // Copy everything first, so nothing changes if that fails
+        std::pmr::vector<value*> copy(_contents.get_allocator());
+        try {
+            copy.reserve(from._contents.size());
+            for (auto item : from._contents)
+                copy.push_back(item->copy_into(get_arena()));
+        } catch (...) {
+            for (auto item : copy)
+                value_utils::release(item);
+            throw;
+        }
+        clear();
+        _contents.swap(copy);
+    }
+    return *this;
+}
+
+value_array& value_array::operator=(value_array &&from) {
+    if (this != &from) {
+        if (get_arena() == from.get_arena()) {
+            clear();
+            _contents.swap(from._contents);
+        } else {
+            // Values can't change memory, so they're copied instead
+            *this = (const value_array&) from;
+            from.clear();
+        }
+    }
+    return *this;
 }
 
 std::vector<value*> value_array::contents() const {
@@ -24,24 +74,51 @@ std::vector<value*> value_array::contents() const {
     return copy;
 }
 
+const std::pmr::vector<value*>& value_array::contents_view() const {return _contents;}
+
 void value_array::set_contents(const std::vector<value*> &contents) {
     // Clear existing values first
     this->clear();
     // Copy new values over
     _contents.reserve(contents.size());
     for (auto item : contents)
-        _contents.push_back(item->copy());
+        _contents.push_back(item->copy_into(get_arena()));
+}
+
+void value_array::set_contents(std::vector<value*> &&contents) {
+    for (auto item : contents)
+        if (!item)
+            throw std::runtime_error("nullptr was given in arguments");
+    clear();
+    _contents.reserve(contents.size());
+    // Values that were already taken over are cleared from the vector as they go, in case copying one fails
+    for (auto &item : contents) {
+        _contents.push_back(value_utils::adopt(item, get_arena()));
+        item = nullptr;
+    }
+    contents.clear();
 }
 
 void value_array::clear() {
     if (!_contents.empty()) {
         for (auto item : _contents)
-            delete item;
+            value_utils::release(item);
         _contents.clear();
     }
 }
 
-value* value_array::copy() const {return new value_array(*this);}
+value* value_array::copy_into(class arena *arena) const {
+    value_array *copy = make<value_array>(arena);
+    try {
+        copy->_contents.reserve(_contents.size());
+        for (auto item : _contents)
+            copy->_contents.push_back(item->copy_into(arena));
+    } catch (...) {
+        value_utils::release(copy);
+        throw;
+    }
+    return copy;
+}
 
 size_t value_array::size() const {return _contents.size();}
 
@@ -50,32 +127,35 @@ value& value_array::at(const size_t pos) const {return *_contents.at(pos);}
 value* value_array::get(const size_t pos) const {return at(pos).copy();}
 
 void value_array::set(const size_t pos, val_type type) {
-    value_utils::change_default(&_contents.at(pos), type);
+    value_utils::change_default(&_contents.at(pos), type, get_arena());
 }
 
 void value_array::set(const size_t pos, const value_auto &new_val) {
-    value_utils::change_auto(&_contents.at(pos), new_val);
+    value_utils::change_auto(&_contents.at(pos), new_val, get_arena());
 }
 
 void value_array::set_move(const size_t pos, value* new_val) {
     if (!new_val)
         throw std::runtime_error("nullptr was given in arguments");
-    delete _contents.at(pos);
-    _contents.at(pos) = new_val;
+    value* &item = _contents.at(pos);
+    new_val = value_utils::adopt(new_val, get_arena());
+    value_utils::release(item);
+    item = new_val;
 }
 
 void value_array::set(iterator pos, val_type type) {
-    value_utils::change_default(&(*pos), type);
+    value_utils::change_default(&(*pos), type, get_arena());
 }
 
 void value_array::set(iterator pos, const value_auto &new_val) {
-    value_utils::change_auto(&(*pos), new_val);
+    value_utils::change_auto(&(*pos), new_val, get_arena());
 }
 
 void value_array::set_move(iterator pos, value* new_val) {
     if (!new_val)
         throw std::runtime_error("nullptr was given in arguments");
-    delete *pos;
+    new_val = value_utils::adopt(new_val, get_arena());
+    value_utils::release(*pos);
     *pos = new_val;
 }
 
@@ -88,21 +168,21 @@ value& value_array::at_back() {
 value* value_array::back() {return at_back().copy();}
 
 void value_array::push_back(val_type type) {
-    value* new_obj = value_utils::new_default(type);
+    value* new_obj = value_utils::new_default(type, get_arena());
     try {
         _contents.push_back(new_obj);
     } catch (...) {
-        delete new_obj;
+        value_utils::release(new_obj);
         throw;
     }
 }
 
 void value_array::push_back(const value_auto &new_val) {
-    value* new_obj = value_utils::new_auto(new_val);
+    value* new_obj = value_utils::new_auto(new_val, get_arena());
     try {
         _contents.push_back(new_obj);
     } catch (...) {
-        delete new_obj;
+        value_utils::release(new_obj);
         throw;
     }
 }
@@ -110,24 +190,25 @@ void value_array::push_back(const value_auto &new_val) {
 void value_array::push_back_move(value* new_val) {
     if (!new_val)
         throw std::runtime_error("nullptr was given in arguments");
+    new_val = value_utils::adopt(new_val, get_arena());
     _contents.push_back(new_val);
 }
 
 void value_array::pop_back() {
     if (_contents.empty())
         throw std::out_of_range("Array is empty");
-    delete _contents.back();
+    value_utils::release(_contents.back());
     _contents.pop_back();
 }
 
 void value_array::insert(const size_t pos, val_type type) {
     if (pos > _contents.size())
         throw std::out_of_range("Out of range");
-    value* new_obj = value_utils::new_default(type);
+    value* new_obj = value_utils::new_default(type, get_arena());
     try {
         _contents.insert(_contents.begin()+pos, new_obj);
     } catch (...) {
-        delete new_obj;
+        value_utils::release(new_obj);
         throw;
     }
 }
@@ -135,11 +216,11 @@ void value_array::insert(const size_t pos, val_type type) {
 void value_array::insert(const size_t pos, const value_auto &new_val) {
     if (pos > _contents.size())
         throw std::out_of_range("Out of range");
-    value* new_obj = value_utils::new_auto(new_val);
+    value* new_obj = value_utils::new_auto(new_val, get_arena());
     try {
         _contents.insert(_contents.begin()+pos, new_obj);
     } catch (...) {
-        delete new_obj;
+        value_utils::release(new_obj);
         throw;
     }
 }
@@ -149,17 +230,18 @@ void value_array::insert_move(const size_t pos, value* new_val) {
         throw std::out_of_range("Out of range");
     if (!new_val)
         throw std::runtime_error("nullptr was given in arguments");
+    new_val = value_utils::adopt(new_val, get_arena());
     _contents.insert(_contents.begin()+pos, new_val);
 }
 
 void value_array::insert(const_iterator pos, val_type type) {
     if (pos < _contents.begin() && _contents.end() < pos)
         throw std::out_of_range("Out of range");
-    value* new_obj = value_utils::new_default(type);
+    value* new_obj = value_utils::new_default(type, get_arena());
     try {
         _contents.insert(pos, new_obj);
     } catch (...) {
-        delete new_obj;
+        value_utils::release(new_obj);
         throw;
     }
 }
@@ -167,11 +249,11 @@ void value_array::insert(const_iterator pos, val_type type) {
 void value_array::insert(const_iterator pos, const value_auto &new_val) {
     if (pos < _contents.begin() && _contents.end() < pos)
         throw std::out_of_range("Out of range");
-    value* new_obj = value_utils::new_auto(new_val);
+    value* new_obj = value_utils::new_auto(new_val, get_arena());
     try {
         _contents.insert(pos, new_obj);
     } catch (...) {
-        delete new_obj;
+        value_utils::release(new_obj);
         throw;
     }
 }
@@ -181,20 +263,21 @@ void value_array::insert_move(const_iterator pos, value* new_val) {
         throw std::out_of_range("Out of range");
     if (!new_val)
         throw std::runtime_error("nullptr was given in arguments");
+    new_val = value_utils::adopt(new_val, get_arena());
     _contents.insert(pos, new_val);
 }
 
 void value_array::erase(const size_t pos) {
     if (pos >= _contents.size())
         throw std::out_of_range("Out of range");
-    delete _contents.at(pos);
+    value_utils::release(_contents.at(pos));
     _contents.erase(_contents.begin()+pos);
 }
 
 void value_array::erase(const_iterator pos) {
     if (pos < _contents.begin() && _contents.end() <= pos)
         throw std::out_of_range("Out of range");
-    delete *pos;
+    value_utils::release(*pos);
     _contents.erase(pos);
 }
 
@@ -205,32 +288,3 @@ value_array::const_iterator value_array::begin() const {return _contents.begin()
 value_array::iterator value_array::end() {return _contents.end();}
 
 value_array::const_iterator value_array::end() const {return _contents.end();}
-
-void value_array::write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline) const {
-    stream << '[';
-    if (!_contents.empty()) {
-        bool first_item = true;
-        // Print each item in the array
-        for (const auto &val : _contents) {
-            // Comma separator
-            if (!first_item)
-                stream << ',';
-            first_item = false;
-            // Newline and space before value (on pretty print)
-            if (pretty_print) {
-                stream << newline;
-                for (int i=0; i<pretty_print_level + pretty_print; i++)
-                    stream << ' ';
-            }
-            // The value itself
-            val->write_to_stream(stream, pretty_print, pretty_print_level + pretty_print, newline);
-        }
-        // Newline and space before end bracket (on pretty print)
-        if (pretty_print) {
-            stream << newline;
-            for (int i=0; i<pretty_print_level; i++)
-                stream << ' ';
-        }
-    }
-    stream << ']';
-}
@@ -6,22 +6,32 @@
 
 #include <vector>
 #include <string>
+#include <memory_resource>
 
 namespace strtb::json {
 
 class value_array : public value {
 private:
-    std::vector<value*> _contents;
-    typedef std::vector<value*>::iterator iterator;
-    typedef std::vector<value*>::const_iterator const_iterator;
+    std::pmr::vector<value*> _contents;
+    typedef std::pmr::vector<value*>::iterator iterator;
+    typedef std::pmr::vector<value*>::const_iterator const_iterator;
 public:
     value_array();
     value_array(const std::vector<value*> &contents);
+    value_array(std::vector<value*> &&contents);
     value_array(const value_array &from);
+    value_array(value_array &&from);
+    value_array(class arena *arena);
+    value_array(class arena *arena, const std::vector<value*> &contents);
+    value_array(class arena *arena, std::vector<value*> &&contents);
     virtual ~value_array();
-    virtual value* copy() const;
+    value_array& operator=(const value_array &from);
+    value_array& operator=(value_array &&from);     // Takes over the values if both use the same memory, and copies them otherwise (which can throw)
+    virtual value* copy_into(class arena *arena) const;
     std::vector<value*> contents() const;
+    const std::pmr::vector<value*>& contents_view() const;
     void set_contents(const std::vector<value*> &contents);
+    void set_contents(std::vector<value*> &&contents);      // Takes over the values, leaving the vector empty
     void clear();
     size_t size() const;
     value& at(const size_t pos) const;
@@ -50,7 +60,6 @@ public:
     const_iterator begin() const;
     iterator end();
     const_iterator end() const;
-    virtual void write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline = "\n") const;
 };
 
 }
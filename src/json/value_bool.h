@@ -11,10 +11,10 @@ private:
 public:
     value_bool();
     value_bool(const bool value);
-    virtual value* copy() const;
+    value_bool(class arena *arena, const bool value);
+    virtual value* copy_into(class arena *arena) const;
     bool value() const;
     void set_value(const bool value);
-    virtual void write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline) const;
 };
 
 }
@@ -12,10 +12,10 @@ private:
 public:
     value_float();
     value_float(const double value);
-    virtual value* copy() const;
+    value_float(class arena *arena, const double value);
+    virtual value* copy_into(class arena *arena) const;
     double value() const;
     void set_value(const double value);
-    virtual void write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline) const;
 };
 
 }
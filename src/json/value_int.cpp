@@ -1,4 +1,5 @@
 #include "value_int.h"
+#include "arena.h"
 
 using namespace strtb;
 using namespace strtb::json;
@@ -7,12 +8,10 @@ value_int::value_int() : json::value(VAL_INT), _value(0) {};
 
 value_int::value_int(const long long value) : json::value(VAL_INT), _value(value) {}
 
+value_int::value_int(class arena *arena, const long long value) : json::value(VAL_INT, arena), _value(value) {}
+
 long long value_int::value() const {return _value;}
 
 void value_int::set_value(const long long value) {_value = value;}
 
-value* value_int::copy() const {return new value_int(_value);}
-
-void value_int::write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline) const {
-    stream << _value;
-}
+value* value_int::copy_into(class arena *arena) const {return make<value_int>(arena, _value);}
@@ -11,10 +11,10 @@ private:
 public:
     value_int();
     value_int(const long long value);
-    virtual value* copy() const;
+    value_int(class arena *arena, const long long value);
+    virtual value* copy_into(class arena *arena) const;
     long long value() const;
     void set_value(const long long value);
-    virtual void write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline) const;
 };
 
 }
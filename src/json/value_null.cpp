@@ -1,12 +1,11 @@
 #include "value_null.h"
+#include "arena.h"
 
 using namespace strtb;
 using namespace strtb::json;
 
 value_null::value_null() : value(VAL_NULL) {}
 
-value* value_null::copy() const {return new value_null();}
+value_null::value_null(class arena *arena) : value(VAL_NULL, arena) {}
 
-void value_null::write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline) const {
-    stream << "null";
-}
+value* value_null::copy_into(class arena *arena) const {return make<value_null>(arena);}
@@ -7,9 +7,9 @@ namespace strtb::json {
 
 class value_null : public value {
 public:
-    virtual value* copy() const;
+    virtual value* copy_into(class arena *arena) const;
     value_null();
-    virtual void write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline) const;
+    value_null(class arena *arena);
 };
 
 }
@@ -1,43 +1,147 @@
 #include "value_object.h"
-#include "../common/strescape.h"
+#include "arena.h"
+#include <algorithm>
 #include <stdexcept>
 
 using namespace strtb;
 using namespace strtb::json;
 
-value_object::value_object() : json::value(VAL_OBJECT) {}
+value_object::value_object() : json::value(VAL_OBJECT), _contents(arena::resource(nullptr)) {}
 
-value_object::value_object(const std::map<std::string, value*> &contents) : json::value(VAL_OBJECT) {set_contents(contents);}
+value_object::value_object(const std::map<std::string, value*> &contents) : value_object() {set_contents(contents);}
 
-value_object::value_object(const value_object &from) : value_object(from._contents) {}
+value_object::value_object(std::map<std::string, value*> &&contents) : value_object() {set_contents(std::move(contents));}
+
+value_object::value_object(value_object &&from) : value_object() {*this = std::move(from);}
+
+value_object::value_object(const value_object &from) : value_object() {
+    _contents.reserve(from._contents.size());
+    for (const auto &item : from._contents)
+        insert_new(_contents.end(), item.first, item.second->copy());
+}
+
+value_object::value_object(class arena *arena) : json::value(VAL_OBJECT, arena), _contents(arena::resource(arena)) {}
+
+value_object::value_object(class arena *arena, const std::map<std::string, value*> &contents) : value_object(arena) {set_contents(contents);}
+
+value_object::value_object(class arena *arena, std::map<std::string, value*> &&contents) : value_object(arena) {set_contents(std::move(contents));}
 
 value_object::~value_object() {
-    for (auto item : _contents)
-        delete item.second;
+    // Values in an arena are freed along with it
+    if (!in_arena())
+        for (auto item : _contents)
+            delete item.second;
 }
 
-value* value_object::copy() const {return new value_object(*this);}
+value_object& value_object::operator=(const value_object &from) {
+    if (this != &from) {
+        // Copy everything first, so nothing changes if that fails
+        value_object copy(get_arena());
+        copy._contents.reserve(from._contents.size());
+        for (const auto &item : from._contents)
+            copy.insert_new(copy._contents.end(), item.first, item.second->copy_into(get_arena()));
+        clear();
+        _contents.swap(copy._contents);
+    }
+    return *this;
+}
+
+value_object& value_object::operator=(value_object &&from) {
+    if (this != &from) {
+        if (get_arena() == from.get_arena()) {
+            clear();
+            _contents.swap(from._contents);
+        } else {
+            // Values can't change memory, so they're copied instead
+            *this = (const value_object&) from;
+            from.clear();
+        }
+    }
+    return *this;
+}
+
+value_object::iterator value_object::find_position(std::string_view key) {
+    // Keys mostly come in order, so check the end first
+    if (_contents.empty() || std::string_view(_contents.back().first) < key)
+        return _contents.end();
+    return std::lower_bound(_contents.begin(), _contents.end(), key, [](const auto &item, std::string_view key) {
+        return std::string_view(item.first) < key;
+    });
+}
+
+value_object::const_iterator value_object::find_position(std::string_view key) const {
+    return ((value_object*) this)->find_position(key);
+}
+
+value_object::iterator value_object::mutable_position(const_iterator pos) {
+    return _contents.begin() + (pos - _contents.cbegin());
+}
+
+bool value_object::matches(const_iterator pos, std::string_view key) const {
+    return pos != _contents.end() && std::string_view(pos->first) == key;
+}
+
+value_object::iterator value_object::insert_new(const_iterator pos, std::string_view key, value* new_val) {
+    // The key is constructed in place with the vector's allocator
+    return _contents.emplace(pos, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(new_val));
+}
+
+value* value_object::copy_into(class arena *arena) const {
+    value_object *copy = make<value_object>(arena);
+    try {
+        copy->_contents.reserve(_contents.size());
+        for (const auto &item : _contents)
+            copy->insert_new(copy->_contents.end(), item.first, item.second->copy_into(arena));
+    } catch (...) {
+        value_utils::release(copy);
+        throw;
+    }
+    return copy;
+}
 
 std::map<std::string, value*> value_object::contents() const {
     std::map<std::string, value*> copy;
     // Create copy of map's contents and return them
     for (auto &item : _contents)
-        copy[item.first] = item.second->copy();
+        copy[std::string(item.first)] = item.second->copy();
     return copy;
 }
 
+const std::pmr::vector<std::pair<std::pmr::string, value*>>& value_object::contents_view() const {return _contents;}
+
 void value_object::set_contents(const std::map<std::string, value*> &contents) {
     // Clear existing values first
     clear();
-    // Copy things over
+    // Copy things over (maps are sorted the same way already)
+    _contents.reserve(contents.size());
     for (auto &item : contents)
-        _contents[item.first] = item.second->copy();
+        insert_new(_contents.end(), item.first, item.second->copy_into(get_arena()));
+}
+
+void value_object::set_contents(std::map<std::string, value*> &&contents) {
+    for (const auto &item : contents)
+        if (!item.second)
+            throw std::runtime_error("nullptr was given in arguments");
+    clear();
+    _contents.reserve(contents.size());
+    // Values that were already taken over are cleared from the map as they go, in case copying one fails
+    for (auto &item : contents) {
+        value* new_val = value_utils::adopt(item.second, get_arena());
+        item.second = nullptr;
+        try {
+            insert_new(_contents.end(), item.first, new_val);
+        } catch (...) {
+            value_utils::release(new_val);
+            throw;
+        }
+    }
+    contents.clear();
 }
 
 void value_object::clear() {
     if (!_contents.empty()) {
         for (auto &item : _contents)
-            delete item.second;
+            value_utils::release(item.second);
         _contents.clear();
     }
 }
@@ -47,119 +151,136 @@ std::vector<std::string> value_object::keys() const {
     copy.reserve(_contents.size());
     // Create copy of map's keys and return them
     for (const auto &item : _contents)
-        copy.push_back(item.first);
+        copy.emplace_back(item.first);
     return copy;
 }
 
 size_t value_object::size() const {return _contents.size();}
 
-value& value_object::at(const std::string &key) const {return *_contents.at(key);}
+value& value_object::at(const std::string &key) const {
+    auto itr = find_position(key);
+    if (!matches(itr, key))
+        throw std::out_of_range("Key not found");
+    return *itr->second;
+}
 
-bool value_object::exists(const std::string &key) const {return _contents.find(key) != _contents.end();}
+bool value_object::exists(const std::string &key) const {return matches(find_position(key), key);}
 
 value* value_object::get(const std::string &key) const {return at(key).copy();}
 
 void value_object::set(const std::string &key, val_type type) {
-    auto itr = _contents.find(key);
-    if (itr == _contents.end()) {
+    auto itr = find_position(key);
+    if (!matches(itr, key)) {
         // Create new key with default value
-        _contents[key] = value_utils::new_default(type);
+        value* new_val = value_utils::new_default(type, get_arena());
+        try {
+            insert_new(itr, key, new_val);
+        } catch (...) {
+            value_utils::release(new_val);
+            throw;
+        }
     } else {
         // Replace existing value
-        value_utils::change_default(&itr->second, type);
+        value_utils::change_default(&itr->second, type, get_arena());
     }
 }
 
 void value_object::set(const std::string &key, const value_auto &new_val) {
-    auto itr = _contents.find(key);
-    if (itr == _contents.end()) {
+    auto itr = find_position(key);
+    if (!matches(itr, key)) {
         // Create new key with this value
-        _contents[key] = value_utils::new_auto(new_val);
+        value* new_obj = value_utils::new_auto(new_val, get_arena());
+        try {
+            insert_new(itr, key, new_obj);
+        } catch (...) {
+            value_utils::release(new_obj);
+            throw;
+        }
     } else {
         // Replace existing value
-        value_utils::change_auto(&itr->second, new_val);
+        value_utils::change_auto(&itr->second, new_val, get_arena());
     }
 }
 
 void value_object::set_move(const std::string &key, value* new_val) {
     if (!new_val)
         throw std::runtime_error("nullptr was given in arguments");
-    auto itr = _contents.find(key);
-    if (itr == _contents.end()) {
+    new_val = value_utils::adopt(new_val, get_arena());
+    auto itr = find_position(key);
+    if (!matches(itr, key)) {
         // Create new key with this value
-        _contents[key] = new_val;
+        insert_new(itr, key, new_val);
     } else {
         // Delete existing value and replace it
-        delete itr->second;
+        value_utils::release(itr->second);
         itr->second = new_val;
     }
 }
 
-void value_object::set(iterator pos, val_type type) {
-    value_utils::change_default(&pos->second, type);
+bool value_object::insert_move(std::string_view key, value* new_val) {
+    if (!new_val)
+        throw std::runtime_error("nullptr was given in arguments");
+    // Find where the key goes and whether it's already there with the same search
+    auto itr = find_position(key);
+    if (matches(itr, key))
+        return false;
+    new_val = value_utils::adopt(new_val, get_arena());
+    try {
+        insert_new(itr, key, new_val);
+    } catch (...) {
+        value_utils::release(new_val);
+        throw;
+    }
+    return true;
 }
 
-void value_object::set(iterator pos, const value_auto &new_val) {
-    value_utils::change_auto(&pos->second, new_val);
+void value_object::append_move_unsorted(std::string_view key, value* new_val) {
+    if (!new_val)
+        throw std::runtime_error("nullptr was given in arguments");
+    new_val = value_utils::adopt(new_val, get_arena());
+    try {
+        insert_new(_contents.end(), key, new_val);
+    } catch (...) {
+        value_utils::release(new_val);
+        throw;
+    }
 }
 
-void value_object::set_move(iterator pos, value* new_val) {
+void value_object::sort() {
+    std::sort(_contents.begin(), _contents.end(), [](const auto &a, const auto &b) {
+        return std::string_view(a.first) < std::string_view(b.first);
+    });
+}
+
+void value_object::set(const_iterator pos, val_type type) {
+    value_utils::change_default(&mutable_position(pos)->second, type, get_arena());
+}
+
+void value_object::set(const_iterator pos, const value_auto &new_val) {
+    value_utils::change_auto(&mutable_position(pos)->second, new_val, get_arena());
+}
+
+void value_object::set_move(const_iterator pos, value* new_val) {
     if (!new_val)
         throw std::runtime_error("nullptr was given in arguments");
-    delete pos->second;
-    pos->second = new_val;
+    new_val = value_utils::adopt(new_val, get_arena());
+    value_utils::release(pos->second);
+    mutable_position(pos)->second = new_val;
 }
 
 void value_object::erase(const std::string &key) {
-    auto itr = _contents.find(key);
-    if (itr == _contents.end())
+    auto itr = find_position(key);
+    if (!matches(itr, key))
         throw std::out_of_range("Key not found");
-    delete itr->second;
+    value_utils::release(itr->second);
     _contents.erase(itr);
 }
 
-void value_object::erase(iterator pos) {
-    delete pos->second;
+void value_object::erase(const_iterator pos) {
+    value_utils::release(pos->second);
     _contents.erase(pos);
 }
 
-value_object::iterator value_object::begin() {return _contents.begin();}
-
 value_object::const_iterator value_object::begin() const {return _contents.begin();}
 
-value_object::iterator value_object::end() {return _contents.end();}
-
 value_object::const_iterator value_object::end() const {return _contents.end();}
-
-void value_object::write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline) const {
-    stream << '{';
-    if (!_contents.empty()) {
-        bool first_item = true;
-        // Print each key/value pair in the object
-        for (const auto &val : _contents) {
-            // Comma separator
-            if (!first_item)
-                stream << ',';
-            first_item = false;
-            // Newline and space before key/value pair (on pretty print)
-            if (pretty_print) {
-                stream << newline;
-                for (int i=0; i<pretty_print_level + pretty_print; i++)
-                    stream << ' ';
-            }
-            // Key
-            stream << common::string_escape(val.first);
-            // Colon separator
-            stream << ": ";
-            // Value
-            val.second->write_to_stream(stream, pretty_print, pretty_print_level + pretty_print, newline);
-        }
-        // Newline and space before end bracket (on pretty print)
-        if (pretty_print) {
-            stream << newline;
-            for (int i=0; i<pretty_print_level; i++)
-                stream << ' ';
-        }
-    }
-    stream << '}';
-}
@@ -6,23 +6,46 @@
 
 #include <map>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
+#include <memory_resource>
 
 namespace strtb::json {
 
 class value_object : public value {
+public:
+    // Members can only be iterated with const keys, since changing a key in place would break the order
+    typedef std::pmr::vector<std::pair<std::pmr::string, value*>>::const_iterator const_iterator;
+
 private:
-    std::map<std::string, value*> _contents;
-    typedef std::map<std::string, value*>::iterator iterator;
-    typedef std::map<std::string, value*>::const_iterator const_iterator;
+    // Members are kept in one vector sorted by key, so lookups are binary searches over contiguous memory, and
+    // there's no allocation per member besides long keys. Keys that come in order (which is how they're written)
+    // are appended without moving anything.
+    std::pmr::vector<std::pair<std::pmr::string, value*>> _contents;
+    typedef std::pmr::vector<std::pair<std::pmr::string, value*>>::iterator iterator;
+    iterator find_position(std::string_view key);
+    const_iterator find_position(std::string_view key) const;
+    iterator mutable_position(const_iterator pos);
+    bool matches(const_iterator pos, std::string_view key) const;
+    iterator insert_new(const_iterator pos, std::string_view key, value* new_val);
 public:
     value_object();
     value_object(const std::map<std::string, value*> &contents);
+    value_object(std::map<std::string, value*> &&contents);
     value_object(const value_object &from);
+    value_object(value_object &&from);
+    value_object(class arena *arena);
+    value_object(class arena *arena, const std::map<std::string, value*> &contents);
+    value_object(class arena *arena, std::map<std::string, value*> &&contents);
     virtual ~value_object();
-    virtual value* copy() const;
+    value_object& operator=(const value_object &from);
+    value_object& operator=(value_object &&from);   // Takes over the values if both use the same memory, and copies them otherwise (which can throw)
+    virtual value* copy_into(class arena *arena) const;
     std::map<std::string, value*> contents() const;
+    const std::pmr::vector<std::pair<std::pmr::string, value*>>& contents_view() const;   // Sorted by key
     void set_contents(const std::map<std::string, value*> &contents);
+    void set_contents(std::map<std::string, value*> &&contents);    // Takes over the values, leaving the map empty
     void clear();
     size_t size() const;
     std::vector<std::string> keys() const;
@@ -32,16 +55,18 @@ public:
     void set(const std::string &key, val_type type);
     void set(const std::string &key, const value_auto &value);
     void set_move(const std::string &key, value* new_val);
-    void set(iterator pos, val_type type);
-    void set(iterator pos, const value_auto &value);
-    void set_move(iterator pos, value* new_val);
+    bool insert_move(std::string_view key, value* new_val);    // Only takes the value (returning true) if the key is new
+    // For building big objects with keys in any order: members are appended without looking at the key (which must
+    // be unique), and sort() must be called before the object is used in any other way
+    void append_move_unsorted(std::string_view key, value* new_val);
+    void sort();
+    void set(const_iterator pos, val_type type);
+    void set(const_iterator pos, const value_auto &value);
+    void set_move(const_iterator pos, value* new_val);
     void erase(const std::string &key);
-    void erase(iterator pos);
-    iterator begin();
+    void erase(const_iterator pos);
     const_iterator begin() const;
-    iterator end();
     const_iterator end() const;
-    virtual void write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline = "\n") const;
 };
 
 }
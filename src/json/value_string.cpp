@@ -1,23 +1,39 @@
 #include "value_string.h"
-#include "../common/strescape.h"
+#include "arena.h"
 
 using namespace strtb;
 using namespace strtb::json;
 
-value_string::value_string() : json::value(VAL_STRING) {};
+value_string::value_string() : json::value(VAL_STRING), _value(arena::resource(nullptr)) {};
 
-value_string::value_string(const char* value) : json::value(VAL_STRING), _value(value) {}
+value_string::value_string(const char* value) : json::value(VAL_STRING), _value(value, arena::resource(nullptr)) {}
 
-value_string::value_string(const std::string &value) : json::value(VAL_STRING), _value(value) {}
+value_string::value_string(const std::string &value) : json::value(VAL_STRING), _value(value.data(), value.size(), arena::resource(nullptr)) {}
 
-std::string value_string::value() const {return _value;}
+value_string::value_string(class arena *arena, std::string_view value) : json::value(VAL_STRING, arena), _value(value, arena::resource(arena)) {}
 
-void value_string::set_value(const char* value) {_value = std::string(value);}
+value_string::value_string(class arena *arena, std::pmr::string &&value) : json::value(VAL_STRING, arena), _value(std::move(value), arena::resource(arena)) {}
 
-void value_string::set_value(const std::string &value) {_value = value;}
+value_string::value_string(const value_string &from) : json::value(from), _value(from._value, arena::resource(nullptr)) {}
 
-value* value_string::copy() const {return new value_string(_value.c_str());}
+value_string::value_string(value_string &&from) : json::value(from), _value(std::move(from._value), arena::resource(nullptr)) {}
 
-void value_string::write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline) const {
-    stream << common::string_escape(_value);
+value_string& value_string::operator=(const value_string &from) {
+    _value = from._value;
+    return *this;
 }
+
+value_string& value_string::operator=(value_string &&from) {
+    _value = std::move(from._value);
+    return *this;
+}
+
+std::string value_string::value() const {return std::string(_value.data(), _value.size());}
+
+std::string_view value_string::value_view() const {return _value;}
+
+void value_string::set_value(const char* value) {_value.assign(value);}
+
+void value_string::set_value(const std::string &value) {_value.assign(value.data(), value.size());}
+
+value* value_string::copy_into(class arena *arena) const {return make<value_string>(arena, _value);}
@@ -3,21 +3,29 @@
 
 #include "value.h"
 #include <string>
+#include <string_view>
+#include <memory_resource>
 
 namespace strtb::json {
 
 class value_string : public value {
 private:
-    std::string _value;
+    std::pmr::string _value;
 public:
     value_string();
     value_string(const char* value);
     value_string(const std::string &value);
-    virtual value* copy() const;
+    value_string(class arena *arena, std::string_view value = std::string_view());
+    value_string(class arena *arena, std::pmr::string &&value);     // Takes over the buffer if it uses the arena's memory
+    value_string(const value_string &from);
+    value_string(value_string &&from);
+    value_string& operator=(const value_string &from);
+    value_string& operator=(value_string &&from);   // Takes over the buffer if both use the same memory, and copies it otherwise (which can throw)
+    virtual value* copy_into(class arena *arena) const;
     std::string value() const;
+    std::string_view value_view() const;
     void set_value(const char* value);
     void set_value(const std::string &value);
-    virtual void write_to_stream(std::ostream &stream, int pretty_print, int pretty_print_level, const char* newline) const;
 };
 
 }
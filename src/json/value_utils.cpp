@@ -6,6 +6,7 @@
 #include "value_string.h"
 #include "value_array.h"
 #include "value_object.h"
+#include "arena.h"
 
 #include <stdexcept>
 
@@ -25,10 +26,13 @@ value_auto::value_auto(const char* v) : _type(VAL_STRING), _is_c_str(true) {_val
 value_auto::value_auto(const std::string &v) : _type(VAL_STRING) {_value.str = &v;}
 value_auto::value_auto(const std::vector<value*> &v) : _type(VAL_ARRAY) {_value.arr = &v;}
 value_auto::value_auto(const std::map<std::string, value*> &v) : _type(VAL_OBJECT) {_value.obj = &v;}
+value_auto::value_auto(std::vector<value*> &&v) : _type(VAL_ARRAY), _is_owned(true) {_value.owned_arr = &v;}
+value_auto::value_auto(std::map<std::string, value*> &&v) : _type(VAL_OBJECT), _is_owned(true) {_value.owned_obj = &v;}
 value_auto::value_auto(const value* v) : _is_ptr(true) {_value.v = v;}
 val_type value_auto::type() const {return _type;}
 bool value_auto::is_ptr() const {return _is_ptr;}
 bool value_auto::is_c_str() const {return _is_c_str;}
+bool value_auto::is_owned() const {return _is_owned;}
 bool value_auto::value_as_bool() const {return _value.b;}
 long long value_auto::value_as_int() const {return _value.i;}
 double value_auto::value_as_float() const {return _value.f;}
@@ -36,71 +40,77 @@ const char* value_auto::value_as_c_str() const {return _value.c_str;}
 const std::string& value_auto::value_as_string() const {return *_value.str;}
 const std::vector<value*>& value_auto::value_as_array() const {return *_value.arr;}
 const std::map<std::string, value*>& value_auto::value_as_object() const {return *_value.obj;}
+std::vector<value*>& value_auto::take_array() const {return *_value.owned_arr;}
+std::map<std::string, value*>& value_auto::take_object() const {return *_value.owned_obj;}
 const value* value_auto::value_as_ptr() const {return _value.v;}
 
-value* value_utils::new_default(val_type type) {
+value* value_utils::new_default(val_type type, class arena *arena) {
     switch (type) {
     case VAL_NULL:
-        return new value_null();
+        return make<value_null>(arena);
         break;
     case VAL_BOOL:
-        return new value_bool();
+        return make<value_bool>(arena, false);
         break;
     case VAL_INT:
-        return new value_int();
+        return make<value_int>(arena, 0);
         break;
     case VAL_FLOAT:
-        return new value_float();
+        return make<value_float>(arena, 0);
         break;
     case VAL_STRING:
-        return new value_string();
+        return make<value_string>(arena);
         break;
     case VAL_ARRAY:
-        return new value_array();
+        return make<value_array>(arena);
         break;
     case VAL_OBJECT:
-        return new value_object();
+        return make<value_object>(arena);
         break;
     default:
         throw json::invalid_type();
     }
 }
 
-value* value_utils::new_auto(const value_auto &val) {
+value* value_utils::new_auto(const value_auto &val, class arena *arena) {
     if (val.is_ptr()) {
         if (!val.value_as_ptr())
             throw std::runtime_error("nullptr was given in arguments");
-        return val.value_as_ptr()->copy();
+        return val.value_as_ptr()->copy_into(arena);
     } else switch (val.type()) {
     case VAL_BOOL:
-        return new value_bool(val.value_as_bool());
+        return make<value_bool>(arena, val.value_as_bool());
     case VAL_INT:
-        return new value_int(val.value_as_int());
+        return make<value_int>(arena, val.value_as_int());
     case VAL_FLOAT:
-        return new value_float(val.value_as_float());
+        return make<value_float>(arena, val.value_as_float());
     case VAL_STRING:
         if (val.is_c_str()) {
             if (!val.value_as_c_str())
                 throw std::runtime_error("nullptr was given in arguments");
-            return new value_string(val.value_as_c_str());
+            return make<value_string>(arena, std::string_view(val.value_as_c_str()));
         } else
-            return new value_string(val.value_as_string());
+            return make<value_string>(arena, val.value_as_string());
     case VAL_ARRAY:
-        return new value_array(val.value_as_array());
+        if (val.is_owned())
+            return make<value_array>(arena, std::move(val.take_array()));
+        return make<value_array>(arena, val.value_as_array());
     case VAL_OBJECT:
-        return new value_object(val.value_as_object());
+        if (val.is_owned())
+            return make<value_object>(arena, std::move(val.take_object()));
+        return make<value_object>(arena, val.value_as_object());
     default:
         throw json::invalid_type();
     }
 }
 
-void value_utils::change_default(value** old_val, val_type type) {
+void value_utils::change_default(value** old_val, val_type type, class arena *arena) {
     val_type old_type = (*old_val)->type();
     switch (type) {
     case VAL_NULL:
         if (old_type != VAL_NULL) {
-            delete *old_val;
-            *old_val = new value_null();
+            release(*old_val);
+            *old_val = make<value_null>(arena);
         }
         break;
 
@@ -108,8 +118,8 @@ void value_utils::change_default(value** old_val, val_type type) {
         if (old_type == VAL_BOOL)
             ((value_bool*)*old_val)->set_value(false);
         else {
-            delete *old_val;
-            *old_val = new value_bool();
+            release(*old_val);
+            *old_val = make<value_bool>(arena, false);
         }
         break;
 
@@ -117,8 +127,8 @@ void value_utils::change_default(value** old_val, val_type type) {
         if (old_type == VAL_INT)
             ((value_int*)*old_val)->set_value(0);
         else {
-            delete *old_val;
-            *old_val = new value_int();
+            release(*old_val);
+            *old_val = make<value_int>(arena, 0);
         }
         break;
 
@@ -126,8 +136,8 @@ void value_utils::change_default(value** old_val, val_type type) {
         if (old_type == VAL_FLOAT)
             ((value_float*)*old_val)->set_value(0);
         else {
-            delete *old_val;
-            *old_val = new value_float();
+            release(*old_val);
+            *old_val = make<value_float>(arena, 0);
         }
         break;
 
@@ -135,8 +145,8 @@ void value_utils::change_default(value** old_val, val_type type) {
         if (old_type == VAL_STRING)
             ((value_string*)*old_val)->set_value("");
         else {
-            delete *old_val;
-            *old_val = new value_string();
+            release(*old_val);
+            *old_val = make<value_string>(arena);
         }
         break;
 
@@ -144,8 +154,8 @@ void value_utils::change_default(value** old_val, val_type type) {
         if (old_type == VAL_ARRAY)
             ((value_array*)*old_val)->clear();
         else {
-            delete *old_val;
-            *old_val = new value_array();
+            release(*old_val);
+            *old_val = make<value_array>(arena);
         }
         break;
 
@@ -153,8 +163,8 @@ void value_utils::change_default(value** old_val, val_type type) {
         if (old_type == VAL_OBJECT)
             ((value_object*)*old_val)->clear();
         else {
-            delete *old_val;
-            *old_val = new value_object();
+            release(*old_val);
+            *old_val = make<value_object>(arena);
         }
         break;
 
@@ -163,22 +173,22 @@ void value_utils::change_default(value** old_val, val_type type) {
     }
 }
 
-void value_utils::change_auto(value** old_val, const value_auto &new_val) {
+void value_utils::change_auto(value** old_val, const value_auto &new_val, class arena *arena) {
     val_type old_type = (*old_val)->type();
 
     if (new_val.is_ptr()) {
         if (!new_val.value_as_ptr())
             throw std::runtime_error("nullptr was given in arguments");
-        delete *old_val;
-        *old_val = new_val.value_as_ptr()->copy();
+        release(*old_val);
+        *old_val = new_val.value_as_ptr()->copy_into(arena);
     } else switch (new_val.type()) {
 
     case VAL_BOOL:
         if (old_type == VAL_BOOL)
             ((value_bool*)*old_val)->set_value(new_val.value_as_bool());
         else {
-            delete *old_val;
-            *old_val = new value_bool(new_val.value_as_bool());
+            release(*old_val);
+            *old_val = make<value_bool>(arena, new_val.value_as_bool());
         }
         break;
 
@@ -186,8 +196,8 @@ void value_utils::change_auto(value** old_val, const value_auto &new_val) {
         if (old_type == VAL_INT)
             ((value_int*)*old_val)->set_value(new_val.value_as_int());
         else {
-            delete *old_val;
-            *old_val = new value_int(new_val.value_as_int());
+            release(*old_val);
+            *old_val = make<value_int>(arena, new_val.value_as_int());
         }
         break;
 
@@ -195,8 +205,8 @@ void value_utils::change_auto(value** old_val, const value_auto &new_val) {
         if (old_type == VAL_FLOAT)
             ((value_float*)*old_val)->set_value(new_val.value_as_float());
         else {
-            delete *old_val;
-            *old_val = new value_float(new_val.value_as_float());
+            release(*old_val);
+            *old_val = make<value_float>(arena, new_val.value_as_float());
         }
         break;
 
@@ -207,34 +217,40 @@ void value_utils::change_auto(value** old_val, const value_auto &new_val) {
             if (old_type == VAL_STRING)
                 ((value_string*)*old_val)->set_value(new_val.value_as_c_str());
             else {
-                delete *old_val;
-                *old_val = new value_string(new_val.value_as_c_str());
+                release(*old_val);
+                *old_val = make<value_string>(arena, std::string_view(new_val.value_as_c_str()));
             }
         } else {
             if (old_type == VAL_STRING)
                 ((value_string*)*old_val)->set_value(new_val.value_as_string());
             else {
-                delete *old_val;
-                *old_val = new value_string(new_val.value_as_string());
+                release(*old_val);
+                *old_val = make<value_string>(arena, new_val.value_as_string());
             }
         }
         break;
 
     case VAL_ARRAY:
-        if (old_type == VAL_ARRAY)
+        if (old_type == VAL_ARRAY && new_val.is_owned())
+            ((value_array*)*old_val)->set_contents(std::move(new_val.take_array()));
+        else if (old_type == VAL_ARRAY)
             ((value_array*)*old_val)->set_contents(new_val.value_as_array());
         else {
-            delete *old_val;
-            *old_val = new value_array(new_val.value_as_array());
+            value* new_obj = new_auto(new_val, arena);
+            release(*old_val);
+            *old_val = new_obj;
         }
         break;
 
     case VAL_OBJECT:
-        if (old_type == VAL_OBJECT)
+        if (old_type == VAL_OBJECT && new_val.is_owned())
+            ((value_object*)*old_val)->set_contents(std::move(new_val.take_object()));
+        else if (old_type == VAL_OBJECT)
             ((value_object*)*old_val)->set_contents(new_val.value_as_object());
         else {
-            delete *old_val;
-            *old_val = new value_object(new_val.value_as_object());
+            value* new_obj = new_auto(new_val, arena);
+            release(*old_val);
+            *old_val = new_obj;
         }
         break;
 
@@ -242,3 +258,17 @@ void value_utils::change_auto(value** old_val, const value_auto &new_val) {
         throw json::invalid_type();
     }
 }
+
+void value_utils::release(value* val) {
+    if (!val->in_arena())
+        delete val;
+}
+
+value* value_utils::adopt(value* val, class arena *arena) {
+    // Values that are already where they belong are kept as they are, anything else is copied over
+    if (val->get_arena() == arena)
+        return val;
+    value* copy = val->copy_into(arena);
+    release(val);
+    return copy;
+}
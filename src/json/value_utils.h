@@ -14,6 +14,7 @@ private:
     val_type _type;
     bool _is_ptr = false;
     bool _is_c_str = false;
+    bool _is_owned = false;
     union {
         bool b;
         long long i;
@@ -22,6 +23,8 @@ private:
         const std::string* str;
         const std::vector<value*>* arr;
         const std::map<std::string, value*>* obj;
+        std::vector<value*>* owned_arr;
+        std::map<std::string, value*>* owned_obj;
         const value* v;
     } _value;
 public:
@@ -37,10 +40,14 @@ public:
     value_auto(const std::string&);
     value_auto(const std::vector<value*>&);
     value_auto(const std::map<std::string, value*>&);
+    // Values in temporary vectors and maps are taken over (leaving them empty) instead of being copied
+    value_auto(std::vector<value*>&&);
+    value_auto(std::map<std::string, value*>&&);
     value_auto(const value*);
     val_type type() const;
     bool is_ptr() const;
     bool is_c_str() const;
+    bool is_owned() const;
     bool value_as_bool() const;
     long long value_as_int() const;
     double value_as_float() const;
@@ -48,15 +55,22 @@ public:
     const std::string& value_as_string() const;
     const std::vector<value*>& value_as_array() const;
     const std::map<std::string, value*>& value_as_object() const;
+    std::vector<value*>& take_array() const;
+    std::map<std::string, value*>& take_object() const;
     const value* value_as_ptr() const;
 };
 
 namespace value_utils {
 
-value* new_default(val_type type);
-value* new_auto(const value_auto &val);
-void change_default(value** old_val, val_type type);
-void change_auto(value** old_val, const value_auto &new_val);
+// All of these make new values in the given arena, or on the heap if it's nullptr
+value* new_default(val_type type, class arena *arena = nullptr);
+value* new_auto(const value_auto &val, class arena *arena = nullptr);
+void change_default(value** old_val, val_type type, class arena *arena = nullptr);
+void change_auto(value** old_val, const value_auto &new_val, class arena *arena = nullptr);
+// Deletes a value, unless it's in an arena (where it's freed along with the arena)
+void release(value* val);
+// Takes ownership of a value and returns it as a value of the given arena (or the heap), copying it if needed
+value* adopt(value* val, class arena *arena);
 
 }
 
@@ -0,0 +1,274 @@
+#include "writer.h"
+#include "all_value_types.h"
+
+#include <charconv>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <system_error>
+#include <unistd.h>
+
+using namespace strtb;
+using namespace strtb::json;
+
+// The internal buffer is flushed once it's past this size
+static const size_t flush_size = 64 * 1024;
+
+namespace {
+
+struct escape_table {
+    // What comes after the backslash for each character that needs escaping ('u' for \u00XX), or 0
+    char escapes[256] = {};
+    constexpr escape_table() {
+        for (int c=0; c<0x20; c++)
+            escapes[c] = 'u';
+        escapes[0x7f] = 'u';    // DEL is allowed as-is by JSON, but not by our parser, so output can be read back
+        escapes[(unsigned char) '\b'] = 'b';
+        escapes[(unsigned char) '\f'] = 'f';
+        escapes[(unsigned char) '\n'] = 'n';
+        escapes[(unsigned char) '\r'] = 'r';
+        escapes[(unsigned char) '\t'] = 't';
+        escapes[(unsigned char) '"'] = '"';
+        escapes[(unsigned char) '\\'] = '\\';
+    }
+};
+
+constexpr escape_table escape_chars;
+
+}
+
+writer::writer(std::string &out, int pretty_print, const char* newline, int pretty_print_level)
+    : _out(&out), _pretty_print(pretty_print), _newline_size(strlen(newline)), _indentation(newline), _level(pretty_print_level) {}
+
+writer::writer(int fd, int pretty_print, const char* newline, int pretty_print_level)
+    : _out(&_buffer), _fd(fd), _pretty_print(pretty_print), _newline_size(strlen(newline)), _indentation(newline), _level(pretty_print_level) {
+    _buffer.reserve(flush_size * 2);
+}
+
+writer::writer(std::ostream &stream, int pretty_print, const char* newline, int pretty_print_level)
+    : _out(&_buffer), _stream(&stream), _pretty_print(pretty_print), _newline_size(strlen(newline)), _indentation(newline), _level(pretty_print_level) {
+    _buffer.reserve(flush_size * 2);
+}
+
+writer::~writer() {
+    // Can't throw from here
+    try {
+        flush();
+    } catch (...) {}
+}
+
+void writer::write(const value &val) {
+    switch (val.type()) {
+    case VAL_NULL:
+        null();
+        break;
+    case VAL_BOOL:
+        boolean(((const value_bool&) val).value());
+        break;
+    case VAL_INT:
+        integer(((const value_int&) val).value());
+        break;
+    case VAL_FLOAT:
+        fraction(((const value_float&) val).value());
+        break;
+    case VAL_STRING:
+        string(((const value_string&) val).value_view());
+        break;
+    case VAL_ARRAY:
+        start_array();
+        for (const auto item : ((const value_array&) val).contents_view())
+            write(*item);
+        end_array();
+        break;
+    case VAL_OBJECT:
+        start_object();
+        for (const auto &item : ((const value_object&) val).contents_view()) {
+            key(item.first);
+            write(*item.second);
+        }
+        end_object();
+        break;
+    default:
+        throw invalid_type();
+    }
+}
+
+void writer::null() {
+    separate();
+    _out->append("null", 4);
+    flush_if_full();
+}
+
+void writer::boolean(bool val) {
+    separate();
+    if (val)
+        _out->append("true", 4);
+    else
+        _out->append("false", 5);
+    flush_if_full();
+}
+
+void writer::integer(long long val) {
+    separate();
+    char buffer[24];
+    char *end = std::to_chars(buffer, buffer + sizeof(buffer), val).ptr;
+    _out->append(buffer, end - buffer);
+    flush_if_full();
+}
+
+void writer::fraction(double val) {
+    separate();
+    // JSON numbers can't be NaN either, so it's written as null
+    if (std::isnan(val)) {
+        _out->append("null", 4);
+        flush_if_full();
+        return;
+    }
+    // Since JSON numbers don't support infinity, write INF as the largest positive/negative doubles, like value_float
+    if (val == std::numeric_limits<double>::infinity())
+        val = std::numeric_limits<double>::max();
+    else if (val == -std::numeric_limits<double>::infinity())
+        val = std::numeric_limits<double>::lowest();
+    // std::to_chars always uses '.' as the decimal point, and gives the shortest text that reads back as the same double
+    char buffer[32];
+    char *end = std::to_chars(buffer, buffer + sizeof(buffer) - 2, val).ptr;
+    // Keep whole numbers looking like floats, so they're read back as one
+    bool whole = true;
+    for (const char *c = buffer; c < end; c++)
+        if (*c == '.' || *c == 'e')
+            whole = false;
+    if (whole) {
+        *end++ = '.';
+        *end++ = '0';
+    }
+    _out->append(buffer, end - buffer);
+    flush_if_full();
+}
+
+void writer::string(std::string_view val) {
+    separate();
+    escaped(val);
+    flush_if_full();
+}
+
+void writer::start_array() {
+    separate();
+    _out->push_back('[');
+    _depth++;
+    _level += _pretty_print;
+    _first = true;
+}
+
+void writer::end_array() {
+    _depth--;
+    _level -= _pretty_print;
+    // Newline and space before end bracket (on pretty print, if there was anything in between)
+    if (_pretty_print && !_first)
+        indent();
+    _out->push_back(']');
+    _first = false;
+    flush_if_full();
+}
+
+void writer::start_object() {
+    separate();
+    _out->push_back('{');
+    _depth++;
+    _level += _pretty_print;
+    _first = true;
+}
+
+void writer::key(std::string_view key) {
+    separate();
+    escaped(key);
+    _out->append(": ", 2);
+    _after_key = true;
+}
+
+void writer::end_object() {
+    _depth--;
+    _level -= _pretty_print;
+    if (_pretty_print && !_first)
+        indent();
+    _out->push_back('}');
+    _first = false;
+    flush_if_full();
+}
+
+void writer::flush() {
+    if (_out != &_buffer || _buffer.empty())
+        return;
+    if (_stream) {
+        _stream->write(_buffer.data(), _buffer.size());
+    } else {
+        const char *data = _buffer.data();
+        size_t left = _buffer.size();
+        while (left > 0) {
+            ssize_t count = ::write(_fd, data, left);
+            if (count >= 0) {
+                data += count;
+                left -= count;
+            } else if (errno != EINTR) {
+                // Keep what wasn't written, in case it's tried again
+                _buffer.erase(0, data - _buffer.data());
+                throw std::ios_base::failure("Couldn't write JSON", std::error_code(errno, std::generic_category()));
+            }
+        }
+    }
+    _buffer.clear();
+}
+
+void writer::separate() {
+    // Values right after a key, and top-level values, need nothing in front of them
+    if (_after_key) {
+        _after_key = false;
+        return;
+    }
+    if (_depth == 0)
+        return;
+    // Comma separator, then newline and space before the value (on pretty print)
+    if (!_first)
+        _out->push_back(',');
+    _first = false;
+    if (_pretty_print)
+        indent();
+}
+
+void writer::indent() {
+    size_t size = _newline_size + _level;
+    if (_indentation.size() < size)
+        _indentation.append(size - _indentation.size(), ' ');
+    _out->append(_indentation.data(), size);
+}
+
+void writer::escaped(std::string_view str) {
+    static const char hex_digits[] = "0123456789abcdef";
+    std::string &out = *_out;
+    out.push_back('"');
+    const char *run = str.data(), *pos = run, *end = run + str.size();
+    while (pos < end) {
+        char escape = escape_chars.escapes[(unsigned char) *pos];
+        if (!escape) {
+            pos++;
+            continue;
+        }
+        // Copy everything up to here as it is, then the escape sequence
+        out.append(run, pos - run);
+        out.push_back('\\');
+        out.push_back(escape);
+        if (escape == 'u') {
+            out.append("00", 2);
+            out.push_back(hex_digits[(unsigned char) *pos >> 4]);
+            out.push_back(hex_digits[*pos & 0xf]);
+        }
+        run = ++pos;
+    }
+    out.append(run, end - run);
+    out.push_back('"');
+}
+
+void writer::flush_if_full() {
+    if (_out == &_buffer && _buffer.size() >= flush_size)
+        flush();
+}
@@ -0,0 +1,63 @@
+#ifndef STRTB_JSON_WRITER_H
+#define STRTB_JSON_WRITER_H
+
+#include "value.h"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace strtb::json {
+
+/* Buffered JSON writer. Output is built in a byte buffer: either a string given by the caller, or an internal one
+ * that is flushed to a file descriptor or stream whenever it fills up. Strings are escaped with a lookup table,
+ * copying runs of characters that don't need escaping at once, indentation is cut from a cached string, and
+ * numbers are formatted with std::to_chars.
+ * Whole values can be written with write(), or documents can be written piece by piece (start_array(), key(),
+ * integer(), etc.), with commas and pretty printing handled by the writer. Output is the same as write_to_stream().
+ */
+class writer {
+private:
+    std::string *_out;
+    std::string _buffer;
+    int _fd = -1;
+    std::ostream *_stream = nullptr;
+    int _pretty_print;
+    size_t _newline_size;
+    std::string _indentation;   // Newline followed by spaces, cut to the needed length
+    int _level;                 // Current indentation in spaces
+    int _depth = 0;             // Arrays and objects that haven't ended yet
+    bool _first = true;         // Nothing written in the current array or object yet
+    bool _after_key = false;
+
+    void separate();
+    void indent();
+    void escaped(std::string_view str);
+    void flush_if_full();
+public:
+    writer(std::string &out, int pretty_print = 0, const char* newline = "\n", int pretty_print_level = 0);    // Appends to the string
+    writer(int fd, int pretty_print = 0, const char* newline = "\n", int pretty_print_level = 0);
+    writer(std::ostream &stream, int pretty_print = 0, const char* newline = "\n", int pretty_print_level = 0);
+    writer(const writer&) = delete;
+    writer& operator=(const writer&) = delete;
+    ~writer();     // Flushes what's left, but errors can only be seen by calling flush() first
+
+    void write(const value &val);
+    void null();
+    void boolean(bool val);
+    void integer(long long val);
+    void fraction(double val);     // Infinities are written as the largest doubles, and NaN as null
+    void string(std::string_view val);
+    void start_array();
+    void end_array();
+    void start_object();
+    void key(std::string_view key);
+    void end_object();
+
+    // Writes everything that's buffered to the file descriptor or stream (does nothing when writing to a string)
+    void flush();
+};
+
+}
+
+#endif // STRTB_JSON_WRITER_H
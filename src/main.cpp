@@ -1,11 +1,13 @@
 #include "gui/main_window.h"
 #include "plugins/loader.h"
 #include "chat/system.h"
+#include "chat/sse_server.h"
 #include "logging/logging.h"
 #include "config/system.h"
 #include "common/version.h"
 
 #include <QApplication>
+#include <QTimer>
 #include <cstdlib>
 #include <string>
 #include <QMessageBox>
@@ -68,14 +70,90 @@ int main(int argc, char *argv[]) {
     // Init other things
     chat::system chat_system;
     chat::main = &chat_system;
+
+    // Optional chat settings, from the "chat" config category
+    chat::sse_config chat_sse_config;
+    try {
+        config_system.load_category("chat");
+        try {
+            if (config_system.get_category_root_type("chat") == json::VAL_OBJECT) {
+                chat_sse_config = chat::read_sse_config(config_system, "chat", "sse_");
+                // Dispatcher thread placement and priority
+                chat::scheduling_config scheduling = chat::read_scheduling_config(config_system, "chat", "dispatcher_");
+                chat_system.set_dispatcher_scheduling(scheduling);
+            }
+        } catch (std::exception &e) {
+            log.put(logging::WARNING, {"Couldn't apply chat settings: ", e.what()});
+        }
+        // It's only read, so it's closed whether the settings could be applied or not
+        config_system.close_category("chat", false);
+    } catch (std::exception &e) {
+        log.put(logging::WARNING, {"Couldn't load chat settings: ", e.what()});
+    }
+
+    // Resume pending chat from the last run, so consumers don't start cold
+    std::filesystem::path chat_snapshot_path;
+    if (home_path != NULL) {
+        chat_snapshot_path = std::filesystem::path(home_path) / ".local/share/streaming-toolbox/chat-snapshot.bin";
+        if (std::filesystem::exists(chat_snapshot_path)) {
+            try {
+                chat_system.restore_snapshot(chat_snapshot_path);
+            } catch (std::exception &e) {
+                log.put(logging::WARNING, {"Couldn't restore chat snapshot: ", e.what()});
+            }
+            // It's only used once (what wasn't claimed yet goes into the next save), so it isn't replayed twice
+            std::error_code error;
+            std::filesystem::remove(chat_snapshot_path, error);
+        }
+    }
     plugins::loader plugin_loader;
 
+    // Serve chat to browser overlays (unless turned off; keep going if the port is taken)
+    chat::sse_server *chat_sse_server = nullptr;
+    if (chat_sse_config.enabled) {
+        try {
+            chat_sse_server = new chat::sse_server(&chat_system, chat_sse_config.port);
+        } catch (std::exception &e) {
+            log.put(logging::WARNING, {"Chat event stream is unavailable: ", e.what()});
+        }
+    }
+
     // Load user plugins
     if (home_path != NULL)
         plugin_loader.load_plugins(std::string(home_path) + "/.local/share/streaming-toolbox/plugins");
 
+    // Keep saving chat state while running, so a warm restart also works after a crash
+    QTimer chat_snapshot_timer;
+    bool chat_snapshot_failed = false;
+    if (!chat_snapshot_path.empty()) {
+        QObject::connect(&chat_snapshot_timer, &QTimer::timeout, [&]() {
+            try {
+                chat_system.save_snapshot(chat_snapshot_path);
+                chat_snapshot_failed = false;
+            } catch (std::exception &e) {
+                // Only report the first failure in a row
+                if (!chat_snapshot_failed)
+                    log.put(logging::WARNING, {"Couldn't save chat snapshot: ", e.what()});
+                chat_snapshot_failed = true;
+            }
+        });
+        chat_snapshot_timer.start(10000);
+    }
+
     // Start GUI
     gui::main_window w(&plugin_loader);
     w.show();
-    return a.exec();
+    int result = a.exec();
+    chat_snapshot_timer.stop();
+
+    // Save chat state for the next run, while subscriptions are still around
+    if (!chat_snapshot_path.empty()) {
+        try {
+            chat_system.save_snapshot(chat_snapshot_path);
+        } catch (std::exception &e) {
+            log.put(logging::WARNING, {"Couldn't save chat snapshot: ", e.what()});
+        }
+    }
+    delete chat_sse_server;
+    return result;
 }
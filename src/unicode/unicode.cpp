@@ -42,3 +42,37 @@ std::string unicode::codepoint_to_utf8(uint32_t codepoint) {
         return "�";
     }
 }
+
+size_t unicode::encode_utf8(uint32_t codepoint, char *out) {
+    // Same as codepoint_to_utf8, but writes into a buffer of at least 4 bytes (and keeps U+0000 as a null byte)
+    if (0xD800 <= codepoint && codepoint <= 0xDFFF) {
+        // Invalid code point (surrogates)
+        return encode_utf8(0xFFFD, out);
+    } else if (codepoint <= 0x7F) {
+        out[0] = codepoint;
+        return 1;
+    } else if (codepoint <= 0x07FF) {
+        out[0] = 0b11000000 | ((codepoint >> 6)  & 0b00011111);
+        out[1] = 0b10000000 | ( codepoint        & 0b00111111);
+        return 2;
+    } else if (codepoint <= 0xFFFF) {
+        out[0] = 0b11100000 | ((codepoint >> 12) & 0b00001111);
+        out[1] = 0b10000000 | ((codepoint >> 6 ) & 0b00111111);
+        out[2] = 0b10000000 | ( codepoint        & 0b00111111);
+        return 3;
+    } else if (codepoint <= 0x10FFFF) {
+        out[0] = 0b11110000 | ((codepoint >> 18) & 0b00000111);
+        out[1] = 0b10000000 | ((codepoint >> 12) & 0b00111111);
+        out[2] = 0b10000000 | ((codepoint >> 6 ) & 0b00111111);
+        out[3] = 0b10000000 | ( codepoint        & 0b00111111);
+        return 4;
+    } else {
+        // Invalid code point (out of valid range)
+        return encode_utf8(0xFFFD, out);
+    }
+}
+
+void unicode::append_utf8(std::string &str, uint32_t codepoint) {
+    char utf8[4];
+    str.append(utf8, encode_utf8(codepoint, utf8));
+}
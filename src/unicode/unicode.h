@@ -7,6 +7,8 @@
 namespace strtb::unicode {
 
 std::string codepoint_to_utf8(uint32_t codepoint);
+size_t encode_utf8(uint32_t codepoint, char *out);
+void append_utf8(std::string &str, uint32_t codepoint);
 
 }
 
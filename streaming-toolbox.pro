@@ -1,7 +1,9 @@
 QT       += core gui
 
 TEMPLATE = subdirs
-SUBDIRS = streaming-toolbox libstrtb
+SUBDIRS = streaming-toolbox libstrtb tests benchmarks
+tests.depends = libstrtb
+benchmarks.depends = libstrtb
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -23,12 +23,23 @@ SOURCES += \
     ../src/plugins/loader.cpp \
 
 HEADERS += \
+    ../src/chat/analytics.h \
+    ../src/chat/batch_writer.h \
     ../src/chat/channel.h \
+    ../src/chat/flood_detector.h \
     ../src/chat/message.h \
+    ../src/chat/middleware.h \
     ../src/chat/provider.h \
     ../src/chat/queue.h \
+    ../src/chat/scheduling.h \
+    ../src/chat/search_index.h \
+    ../src/chat/snapshot.h \
+    ../src/chat/sse_server.h \
     ../src/chat/subscription.h \
     ../src/chat/system.h \
+    ../src/chat/timestamp_merger.h \
+    ../src/chat/tokenizer.h \
+    ../src/chat/topology.h \
     ../src/common/deregistration_interface.h \
     ../src/common/strescape.h \
     ../src/common/version.h \
@@ -39,7 +50,14 @@ HEADERS += \
     ../src/gui/main_window.h \
     ../src/gui/plugin_tab.h \
     ../src/json/all_value_types.h \
+    ../src/json/arena.h \
+    ../src/json/compact.h \
+    ../src/json/incremental.h \
+    ../src/json/lazy.h \
     ../src/json/parser.h \
+    ../src/json/parser_core.h \
+    ../src/json/reader.h \
+    ../src/json/structural_index.h \
     ../src/json/value.h \
     ../src/json/value_array.h \
     ../src/json/value_bool.h \
@@ -49,6 +67,7 @@ HEADERS += \
     ../src/json/value_object.h \
     ../src/json/value_string.h \
     ../src/json/value_utils.h \
+    ../src/json/writer.h \
     ../src/logging/logging.h \
     ../src/plugins/plugin.h \
     ../src/plugins/link.h \
@@ -0,0 +1,72 @@
+#include "check.h"
+#include "../src/chat/system.h"
+
+#include <thread>
+
+using namespace strtb;
+using namespace strtb::tests;
+
+static long long now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static chat::message timestamped(const std::string &text, long long timestamp) {
+    chat::message msg;
+    msg.message = text;
+    msg.timestamp = timestamp;
+    return msg;
+}
+
+// Messages of two providers that arrive interleaved out of order within the window come out sorted by timestamp
+static void ordered_across_providers() {
+    chat::system sys;
+    sys.set_merge_window(std::chrono::milliseconds(300));
+    chat::subscription *sub = sys.subscribe("", "");
+    chat::provider *p1 = sys.register_provider("p1", "P1");
+    chat::provider *p2 = sys.register_provider("p2", "P2");
+    chat::channel *c1 = p1->register_channel("c", "C");
+    chat::channel *c2 = p2->register_channel("c", "C");
+
+    long long base = now_ms();
+    std::vector<chat::message> msgs = {timestamped("a", base - 50), timestamped("b", base - 40), timestamped("c", base - 30),
+                                       timestamped("d", base - 20), timestamped("e", base - 10)};
+    c2->push(msgs[1]);
+    c2->push(msgs[3]);
+    c1->push(msgs[0]);
+    c1->push(msgs[2]);
+    c1->push(msgs[4]);
+
+    std::string order;
+    while (order.size() < 5)
+        for (auto &msg : sub->pull())
+            order += msg.message;
+    check(order == "abcde", "messages of both providers were released in timestamp order");
+    check(sys.get_merge_stats().late_messages == 0, "nothing arrived too late to be ordered");
+
+    sub->unsubscribe();
+    delete sub;
+    delete c1;
+    delete c2;
+    delete p1;
+    delete p2;
+}
+
+// The reported delay is the average over held messages, not diluted by ones that were passed through
+static void delay_of_held_messages() {
+    chat::timestamp_merger merger;
+    std::vector<chat::message> held = {timestamped("held", now_ms())};
+    merger.add(held);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::vector<chat::message> untimed(9, timestamped("untimed", 0));
+    merger.add(untimed);
+    std::vector<chat::message> ready = merger.take_ready(std::chrono::milliseconds(50));
+    check(ready.size() == 10, "held message was released after waiting for the whole window");
+    chat::merge_stats stats = merger.get_stats();
+    check(stats.messages == 10, "all messages were counted");
+    check(stats.average_delay_ms >= 50, "average delay only covers the held message");
+}
+
+void tests::chat_merger() {
+    ordered_across_providers();
+    delay_of_held_messages();
+}
@@ -0,0 +1,128 @@
+#include "check.h"
+#include "../src/chat/queue.h"
+
+#include <atomic>
+#include <future>
+#include <thread>
+
+using namespace strtb;
+using namespace strtb::tests;
+
+static chat::message text(const std::string &text) {
+    chat::message msg;
+    msg.message = text;
+    return msg;
+}
+
+// Pushing with nobody parked doesn't notify, and pushing to a parked puller does
+static void notify_only_parked() {
+    chat::queue q;
+    for (int i=0; i<100; i++)
+        q.push(text("x"));
+    check(q.get_notify_count() == 0, "pushes without a waiter didn't notify");
+    check(q.pull().size() == 100, "messages pushed without notifying were pulled");
+
+    auto pulled = std::async(std::launch::async, [&q]() {return q.pull();});
+    // Long enough for the puller to stop spinning and park
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    q.push(text("y"));
+    check(pulled.wait_for(std::chrono::seconds(5)) == std::future_status::ready && pulled.get().size() == 1,
+          "parked puller got the message");
+    check(q.get_notify_count() == 1, "push to a parked puller notified once");
+}
+
+// Deleting the queue wakes up every puller, whether they're still spinning or already parked
+static void deletion_wakes_pullers() {
+    for (int wait_ms : {0, 200}) {
+        chat::queue *q = new chat::queue();
+        // The pullers tell the queue when it's safe to go, like the dispatcher does
+        q->block_deletion();
+        std::atomic<int> woken = 0;
+        auto puller = [q, &woken]() {
+            if (q->pull().empty() && ++woken == 2)
+                q->allow_deletion();
+        };
+        auto first = std::async(std::launch::async, puller);
+        auto second = std::async(std::launch::async, puller);
+        std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+        auto deleted = std::async(std::launch::async, [q]() {delete q;});
+        check(deleted.wait_for(std::chrono::seconds(5)) == std::future_status::ready && woken == 2,
+              wait_ms ? "deletion woke up both parked pullers" : "deletion woke up both spinning pullers");
+    }
+}
+
+// close() wakes up pullers, whether they're still spinning or already parked
+static void close_wakes_pullers() {
+    {
+        chat::queue q;
+        auto pulled = std::async(std::launch::async, [&q]() {return q.pull();});
+        q.close();
+        check(pulled.wait_for(std::chrono::seconds(5)) == std::future_status::ready && pulled.get().empty(),
+              "close() woke up a spinning puller");
+    }
+    {
+        chat::queue q;
+        auto pulled = std::async(std::launch::async, [&q]() {return q.pull();});
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        q.close();
+        check(pulled.wait_for(std::chrono::seconds(5)) == std::future_status::ready && pulled.get().empty(),
+              "close() woke up a parked puller");
+    }
+}
+
+// Only a pull that had to park and be woken up reports a wakeup delay
+static void wakeup_delay_only_parked() {
+    chat::queue q;
+    q.push(text("x"));
+    q.pull();
+    check(q.get_last_wakeup_delay() == std::chrono::steady_clock::duration::zero(), "pull that didn't park has no wakeup delay");
+
+    auto pulled = std::async(std::launch::async, [&q]() {return q.pull();});
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    q.push(text("y"));
+    check(pulled.wait_for(std::chrono::seconds(5)) == std::future_status::ready && pulled.get().size() == 1,
+          "parked puller got the message");
+    auto delay = q.get_last_wakeup_delay();
+    check(delay > std::chrono::steady_clock::duration::zero() && delay < std::chrono::milliseconds(200),
+          "parked pull reports the time from the push to running again, not the time it waited");
+}
+
+// Messages that waited too long are dropped when pulled, and counted
+static void expired_dropped_at_pull() {
+    chat::queue q;
+    q.set_max_age(std::chrono::milliseconds(50));
+    q.push(text("old"));
+    q.push(text("old"));
+    q.push(text("old"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    check(q.pull_instantly().empty(), "expired messages weren't handed out");
+    check(q.get_expired_count() == 3, "expired messages were counted");
+}
+
+// A pull that finds only expired messages keeps waiting, since an empty result would mean the queue was closed
+static void all_expired_pull_blocks() {
+    chat::queue q;
+    q.set_max_age(std::chrono::milliseconds(50));
+    q.push(text("old"));
+    q.push(text("old"));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto pulled = std::async(std::launch::async, [&q]() {return q.pull();});
+    check(pulled.wait_for(std::chrono::milliseconds(200)) == std::future_status::timeout,
+          "pull kept waiting after everything expired");
+    q.push(text("new"));
+    bool ready = pulled.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+    std::vector<chat::message> messages = ready ? pulled.get() : std::vector<chat::message>();
+    check(messages.size() == 1 && messages[0].message == "new", "pull returned the fresh message only");
+    check(q.get_expired_count() == 2, "messages that expired while waiting were counted");
+    if (!ready)
+        q.close();
+}
+
+void tests::chat_queue() {
+    notify_only_parked();
+    deletion_wakes_pullers();
+    close_wakes_pullers();
+    wakeup_delay_only_parked();
+    expired_dropped_at_pull();
+    all_expired_pull_blocks();
+}
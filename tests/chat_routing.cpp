@@ -0,0 +1,44 @@
+#include "check.h"
+#include "../src/chat/system.h"
+
+#include <thread>
+
+using namespace strtb;
+using namespace strtb::tests;
+
+// Subscriptions come and go while the dispatcher is busy pushing to the routing tables they replace
+static void churn_while_dispatching() {
+    chat::system sys;
+    chat::provider *prov = sys.register_provider("p", "P");
+    chat::channel *chan = prov->register_channel("c", "C");
+    chat::message msg;
+    msg.message = "x";
+
+    for (int i=0; i<100; i++) {
+        chat::subscription *sub = sys.subscribe("p", i % 2 ? "c" : "");
+        // Once the first messages of a big batch arrive, the dispatcher is still busy with the rest of it, and its epoch
+        // covers the table that unsubscribing retires
+        chan->push(std::vector<chat::message>(20000, msg));
+        sub->pull();
+        sub->unsubscribe();
+        delete sub;
+    }
+
+    chat::routing_stats stats = sys.get_routing_stats();
+    check(stats.retired == 200, "every subscribe and unsubscribe retired the routing table it replaced");
+    check(stats.freed_in_use == 0, "nothing was freed while the dispatcher's epoch still covered it");
+
+    // Whatever was retired during the last dispatches gets freed once the dispatcher goes idle
+    for (int i=0; i<100 && stats.freed < stats.retired; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        stats = sys.get_routing_stats();
+    }
+    check(stats.freed == stats.retired, "idle dispatcher freed everything retired, without another subscription change");
+
+    delete chan;
+    delete prov;
+}
+
+void tests::chat_routing() {
+    churn_while_dispatching();
+}
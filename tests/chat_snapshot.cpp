@@ -0,0 +1,91 @@
+#include "check.h"
+#include "../src/chat/system.h"
+
+#include <thread>
+#include <unistd.h>
+
+using namespace strtb;
+using namespace strtb::tests;
+
+static bool same_contents(const chat::message &a, const chat::message &b) {
+    return a.provider_id == b.provider_id && a.channel_id == b.channel_id && a.user_id == b.user_id &&
+           a.user_name == b.user_name && a.message == b.message && a.is_mod == b.is_mod &&
+           a.is_paid_member == b.is_paid_member && a.timestamp == b.timestamp && a.more_metadata == b.more_metadata;
+}
+
+// Pending messages survive saving, restoring into a new system, and being claimed by a new subscription
+static void save_restore_subscribe() {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / ("strtb-tests-snapshot-" + std::to_string(getpid()));
+    std::vector<chat::message> sent(2);
+    sent[0].user_id = "u1";
+    sent[0].user_name = "User \xce\xb1";
+    sent[0].message = "first";
+    sent[0].is_mod = true;
+    sent[0].timestamp = 1700000000000;
+    sent[1].user_id = "u2";
+    sent[1].message = std::string("second\0with a null", 18);
+    sent[1].is_paid_member = true;
+    sent[1].more_metadata["badge"] = "sub";
+
+    chat::snapshot saved;
+    {
+        chat::system sys;
+        chat::subscription *sub = sys.subscribe("p", "c");
+        chat::provider *prov = sys.register_provider("p", "P");
+        chat::channel *chan = prov->register_channel("c", "C");
+        chan->push(std::vector<chat::message>(sent));
+        // Wait for the dispatcher to deliver them
+        for (int i=0; i<100; i++) {
+            sys.save_snapshot(path);
+            saved = chat::snapshot::read_from_file(path);
+            if (saved.queues.size() == 1 && saved.queues[0].messages.size() == 2)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        // Let them age a bit before the final save
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        sys.save_snapshot(path);
+        saved = chat::snapshot::read_from_file(path);
+        sub->unsubscribe();
+        delete sub;
+        delete chan;
+        delete prov;
+    }
+    check(saved.providers.size() == 1 && saved.providers[0].id == "p" && saved.providers[0].channels.size() == 1,
+          "snapshot has the registered provider and channel");
+    check(saved.queues.size() == 1 && saved.queues[0].messages.size() == 2, "snapshot has the pending messages");
+    if (saved.queues.size() != 1 || saved.queues[0].messages.size() != 2) {
+        std::filesystem::remove(path);
+        return;
+    }
+    for (auto &item : saved.queues[0].messages)
+        check(item.age >= std::chrono::milliseconds(100), "saved messages have their ages");
+
+    chat::system sys;
+    sys.restore_snapshot(path);
+    chat::subscription *sub = sys.subscribe("p", "c");
+    // Save again before pulling, to see the ages the claimed queue carried over
+    std::filesystem::path second_path = path;
+    second_path += "-2";
+    sys.save_snapshot(second_path);
+    chat::snapshot resaved = chat::snapshot::read_from_file(second_path);
+    check(resaved.queues.size() == 1 && resaved.queues[0].messages.size() == 2, "restored messages went to the new subscription");
+    for (size_t i=0; i<resaved.queues.size(); i++)
+        for (size_t j=0; j<resaved.queues[i].messages.size() && j<2; j++)
+            check(resaved.queues[i].messages[j].age >= saved.queues[0].messages[j].age, "restored messages kept their ages");
+    std::vector<chat::message> pulled = sub->pull();
+    check(pulled.size() == 2 && same_contents(pulled[0], saved.queues[0].messages[0].msg) &&
+          same_contents(pulled[1], saved.queues[0].messages[1].msg), "restored messages have the saved contents");
+    check(pulled.size() == 2 && pulled[0].message == "first" && pulled[0].user_name == sent[0].user_name &&
+          pulled[0].is_mod && pulled[0].timestamp == sent[0].timestamp, "first message came back as it was sent");
+    check(pulled.size() == 2 && pulled[1].message == sent[1].message && pulled[1].is_paid_member &&
+          pulled[1].more_metadata == sent[1].more_metadata, "second message came back as it was sent");
+    sub->unsubscribe();
+    delete sub;
+    std::filesystem::remove(path);
+    std::filesystem::remove(second_path);
+}
+
+void tests::chat_snapshot() {
+    save_restore_subscribe();
+}
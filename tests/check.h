@@ -0,0 +1,32 @@
+#ifndef STRTB_TESTS_CHECK_H
+#define STRTB_TESTS_CHECK_H
+
+#include <cstdio>
+
+namespace strtb::tests {
+
+extern int failures;
+
+// Reports a failed check without stopping, so one run shows everything that's broken
+inline void check(bool ok, const char *what) {
+    if (!ok) {
+        fprintf(stderr, "FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// Test groups, one per file
+void chat_merger();
+void chat_queue();
+void chat_routing();
+void chat_snapshot();
+void json_arena();
+void json_incremental();
+void json_lazy();
+void json_parser();
+void json_reader();
+void json_writer();
+
+}
+
+#endif // STRTB_TESTS_CHECK_H
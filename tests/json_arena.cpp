@@ -0,0 +1,75 @@
+#include "check.h"
+#include "../src/json/parser.h"
+#include "../src/json/arena.h"
+
+using namespace strtb;
+using namespace strtb::tests;
+
+// A value from another arena must be copied in when moved into a container, since that arena can go away first
+static void moved_between_arenas() {
+    json::arena a1;
+    json::value_array *arr = (json::value_array*) json::parser::from_string("[1]", &a1);
+    json::value_object *obj = (json::value_object*) json::parser::from_string("{}", &a1);
+    {
+        json::arena a2;
+        json::value *str = json::parser::from_string("\"a string that's too long for any small string buffer\"", &a2);
+        arr->push_back_move(str);
+        check(&arr->at_back() != str && arr->at_back().get_arena() == &a1, "array item was copied into its arena");
+        json::value *other = json::parser::from_string("[true, null]", &a2);
+        obj->set_move("x", other);
+        check(&obj->at("x") != other && obj->at("x").get_arena() == &a1, "object member was copied into its arena");
+    }
+    check(arr->write_to_string() == "[1,\"a string that's too long for any small string buffer\"]",
+          "array still readable after the other arena is gone");
+    check(obj->write_to_string() == "{\"x\": [true,null]}", "object still readable after the other arena is gone");
+}
+
+// Values of the same arena are taken as they are, and heap values are copied in and deleted
+static void moved_within_arena() {
+    json::arena a;
+    json::value_array *arr = (json::value_array*) json::parser::from_string("[]", &a);
+    json::value *same = json::parser::from_string("\"same\"", &a);
+    arr->push_back_move(same);
+    check(&arr->at_back() == same, "value of the same arena was kept");
+    arr->push_back_move(json::parser::from_string("\"heap\""));
+    check(arr->at_back().get_arena() == &a, "heap value was copied into the arena");
+}
+
+// Arena values are copied out when moved into a heap container
+static void moved_out_of_arena() {
+    json::value_array *arr = (json::value_array*) json::parser::from_string("[]");
+    {
+        json::arena a;
+        arr->push_back_move(json::parser::from_string("{\"k\": \"v\"}", &a));
+    }
+    check(arr->at_back().get_arena() == nullptr, "arena value was copied onto the heap");
+    check(arr->write_to_string() == "[{\"k\": \"v\"}]", "heap copy still readable after the arena is gone");
+    delete arr;
+}
+
+// Move assignment takes over the values within one arena, and copies them (leaving the source empty) across arenas
+static void move_assignment() {
+    json::arena a1, a2;
+    json::value_array *src = (json::value_array*) json::parser::from_string("[\"a string that's too long for any small string buffer\"]", &a1);
+    json::value_array *same = (json::value_array*) json::parser::from_string("[]", &a1);
+    json::value *item = &src->at(0);
+    *same = std::move(*src);
+    check(same->size() == 1 && &same->at(0) == item && src->size() == 0, "values were taken over within the arena");
+
+    json::value_array *other = (json::value_array*) json::parser::from_string("[]", &a2);
+    *other = std::move(*same);
+    check(other->size() == 1 && &other->at(0) != item && other->at(0).get_arena() == &a2 && same->size() == 0,
+          "values were copied into the other arena");
+
+    json::value_string *str = (json::value_string*) json::parser::from_string("\"a string that's too long for any small string buffer\"", &a1);
+    json::value_string heap(std::move(*str));
+    check(heap.get_arena() == nullptr && heap.value_view() == "a string that's too long for any small string buffer",
+          "string moved out of an arena was copied to the heap");
+}
+
+void tests::json_arena() {
+    moved_between_arenas();
+    moved_within_arena();
+    moved_out_of_arena();
+    move_assignment();
+}
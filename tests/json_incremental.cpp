@@ -0,0 +1,103 @@
+#include "check.h"
+#include "../src/json/incremental.h"
+#include "../src/json/parser.h"
+
+using namespace strtb;
+using namespace strtb::tests;
+
+// Takes every value that's complete so far, and lists them (or the errors) one per line
+static std::string take_all(json::parser::incremental &in) {
+    std::string out;
+    while (true) {
+        try {
+            json::value *val = in.next();
+            if (!val)
+                return out;
+            out += val->write_to_string() + "\n";
+            delete val;
+        } catch (json::parser::invalid_json &e) {
+            out += std::string(e.what()) + "\n";
+        }
+    }
+}
+
+// Values right next to each other, between whitespace, with escapes and brackets in strings, and scalars at the end
+static const char *stream = "{\"a\": [1, \"x\\\"}]\", {}], \"b\\\\\": null}\n[2]\"s\\\\\"\"{[\"12 true{\"c\":\n-0.5e1} \r\n"
+                            "[[], [[\"]\"]]] -7";
+
+// Feeding the stream in two parts gives the same values wherever it's split, and so does feeding it byte by byte
+static void split_anywhere() {
+    std::string text = stream;
+    json::parser::incremental whole;
+    whole.feed(text);
+    whole.finish();
+    std::string expected = take_all(whole);
+    check(expected == "{\"a\": [1,\"x\\\"}]\",{}],\"b\\\\\": null}\n[2]\n\"s\\\\\"\n\"{[\"\n12\ntrue\n{\"c\": -5.0}\n"
+                      "[[],[[\"]\"]]]\n-7\n", "whole stream gave every value");
+
+    for (size_t split=0; split<=text.size(); split++) {
+        json::parser::incremental in;
+        in.feed(text.data(), split);
+        std::string out = take_all(in);
+        in.feed(text.data() + split, text.size() - split);
+        in.finish();
+        out += take_all(in);
+        if (out != expected) {
+            check(false, ("stream split at " + std::to_string(split) + " gave the same values").c_str());
+            return;
+        }
+    }
+
+    json::parser::incremental bytes;
+    std::string out;
+    for (char c : text) {
+        bytes.feed(&c, 1);
+        out += take_all(bytes);
+    }
+    bytes.finish();
+    out += take_all(bytes);
+    check(out == expected, "stream fed byte by byte gave the same values");
+    check(bytes.buffered() == 0, "nothing is kept after every value was taken");
+}
+
+// Newline-delimited values come out one by one as each line arrives
+static void ndjson() {
+    json::parser::incremental in;
+    in.feed("{\"n\": 1}\n{\"n\"");
+    check(take_all(in) == "{\"n\": 1}\n", "first line was complete");
+    in.feed(": 2}\n");
+    check(take_all(in) == "{\"n\": 2}\n", "second line was completed by the next chunk");
+    check(in.buffered() == 0, "newline after the last value isn't kept");
+}
+
+// A top-level number can't be known to be complete before something follows it, or the stream ends
+static void scalars_need_an_end() {
+    json::parser::incremental in;
+    in.feed("12");
+    check(take_all(in).empty(), "number at the end of the data isn't complete yet");
+    in.feed("3 4");
+    check(take_all(in) == "123\n", "number was completed by the whitespace after it");
+    in.finish();
+    check(take_all(in) == "4\n", "last number was completed by finish()");
+
+    json::parser::incremental unterminated;
+    unterminated.feed("[1, 2");
+    check(take_all(unterminated).empty(), "open array isn't complete");
+    unterminated.finish();
+    check(take_all(unterminated).compare(0, 8, "invalid ") == 0, "array left open at the end is reported");
+}
+
+// An invalid value is reported where it is in the whole stream (at the bracket after the trailing comma), and skipped
+static void invalid_value_skipped() {
+    json::parser::incremental in;
+    in.feed("[1]\n  {\"a\": 1,}\n[2]");
+    in.finish();
+    check(take_all(in) == "[1]\ninvalid JSON at line 2, col 11\n[2]\n", "value after the invalid one was read");
+}
+
+void tests::json_incremental() {
+    split_anywhere();
+    ndjson();
+    scalars_need_an_end();
+    invalid_value_skipped();
+}
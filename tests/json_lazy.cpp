@@ -0,0 +1,139 @@
+#include "check.h"
+#include "../src/json/lazy.h"
+#include "../src/json/parser.h"
+#include "../src/json/all_value_types.h"
+
+#include <stdexcept>
+
+using namespace strtb;
+using namespace strtb::tests;
+
+// Value a JSON pointer leads to in a parsed document, as text, or an empty string if there is none
+static std::string dom_lookup(const json::value *val, std::string_view pointer) {
+    while (!pointer.empty()) {
+        size_t slash = pointer.find('/', 1);
+        std::string token(pointer.substr(1, slash == std::string_view::npos ? slash : slash - 1));
+        pointer = slash == std::string_view::npos ? std::string_view() : pointer.substr(slash);
+        for (size_t i=0; (i = token.find('~', i)) != std::string::npos; i++)
+            token.replace(i, 2, token[i+1] == '0' ? "~" : "/");
+
+        const json::value *found = nullptr;
+        if (val->type() == json::VAL_OBJECT) {
+            for (const auto &item : ((const json::value_object*) val)->contents_view())
+                if (std::string_view(item.first) == token)
+                    found = item.second;
+        } else if (val->type() == json::VAL_ARRAY) {
+            const json::value_array *arr = (const json::value_array*) val;
+            bool digits = !token.empty() && token.find_first_not_of("0123456789") == std::string::npos;
+            if (digits && (token[0] != '0' || token.size() == 1) && token.size() < 10 && std::stoul(token) < arr->size())
+                found = &arr->at(std::stoul(token));
+        }
+        if (!found)
+            return "";
+        val = found;
+    }
+    return val->write_to_string();
+}
+
+// The same through the lazy document
+static std::string lazy_lookup(const json::parser::lazy &doc, std::string_view pointer) {
+    try {
+        json::value *val = doc.get(pointer);
+        std::string out = val->write_to_string();
+        delete val;
+        if (!doc.contains(pointer))
+            return "contains() disagrees with get()";
+        return out;
+    } catch (std::out_of_range&) {
+        if (doc.contains(pointer))
+            return "contains() disagrees with get()";
+        return "";
+    }
+}
+
+// Keys with escapes in the document, and characters that have to be escaped in pointers
+static const char *document = "{\"a/b\": 1, \"m~n\": 2, \"~1\": 3, \"\\u0061bc\": 4, \"q\\\"uote\": {\"back\\\\slash\": [10, 20, "
+                              "{\"\\u00e9\\ud83d\\ude00\": true}]}, \"list\": [0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11], "
+                              "\"\": {\"\": \"empty\"}, \"nested\": {\"a\": {\"a\": null}}}";
+
+// Values found lazily are the same as the ones found in the parsed document, and so are values that aren't there
+static void get_matches_dom() {
+    std::string text = document;
+    json::parser::lazy doc(text.data(), text.size());
+    json::value *val = json::parser::from_string(text);
+    for (const char *pointer : {"", "/a~1b", "/m~0n", "/~01", "/~1", "/abc", "/q\"uote", "/q\"uote/back\\slash/2/\u00e9\U0001F600",
+                                "/q\"uote/back\\slash/2/\u00e9\U0001F600/x", "/list/0", "/list/10", "/list/11", "/list/12",
+                                "/list/01", "/list/00", "/list/-", "/list/+1", "/list/1e1", "/list/", "/list/99999999999999999999",
+                                "/", "//", "/nested/a/a", "/nested/a/b", "/a", "/a~1b/0", "/list/3/x"}) {
+        std::string expected = dom_lookup(val, pointer);
+        if (lazy_lookup(doc, pointer) != expected)
+            check(false, (std::string("lazy get() matches the parsed document for ") + pointer).c_str());
+    }
+    check(dom_lookup(val, "/q\"uote/back\\slash/2/\u00e9\U0001F600") == "true", "escaped keys were found at all");
+    check(dom_lookup(val, "/list/11") == "11" && dom_lookup(val, "/list/12").empty(), "array indices were checked");
+    delete val;
+
+    check(doc.raw("/list/11") == "11" && doc.raw("/q\"uote/back\\slash/1") == "20", "raw text of values is given as it is");
+    bool thrown = false;
+    try {
+        doc.contains("list");
+    } catch (std::invalid_argument&) {
+        thrown = true;
+    }
+    check(thrown, "pointer without a leading slash is rejected");
+    thrown = false;
+    try {
+        doc.contains("/m~2n");
+    } catch (std::invalid_argument&) {
+        thrown = true;
+    }
+    check(thrown, "pointer with an invalid escape is rejected");
+}
+
+// Error of opening lazily, or an empty string
+static std::string open_error(const std::string &text) {
+    try {
+        json::parser::lazy doc(text.data(), text.size());
+        return "";
+    } catch (json::parser::invalid_json &e) {
+        return e.what();
+    }
+}
+
+// Error of parsing, or an empty string
+static std::string parse_error(const std::string &text) {
+    try {
+        delete json::parser::from_string(text);
+        return "";
+    } catch (json::parser::invalid_json &e) {
+        return e.what();
+    }
+}
+
+// Objects with many keys, so duplicates have to be found among more than a handful
+static std::string many_keys(const std::string &extra) {
+    std::string text = "{";
+    for (int i=0; i<100; i++)
+        text += "\"k" + std::to_string((i * 37) % 100) + "\": [" + std::to_string(i) + "], ";
+    return text + extra + "\"end\": {}}";
+}
+
+// Duplicate keys are rejected like the parser does, at the same position, but the same key in other objects is fine
+static void duplicate_keys() {
+    std::vector<std::string> documents = {
+        "{\"a\": 1, \"a\": 2}", "{\"a\": 1, \"\\u0061\": 2}", "{\"\\\"\": 1, \"\\u0022\": 2}", "{\"a\": {\"b\": 1, \"b\": 2}}",
+        "[{\"a\": 1}, {\"a\": 2, \"b\": 3, \"a\": 4}]", "{\"a\": {\"a\": {\"a\": 1}}, \"b\": {\"a\": 2}}", "{\"a\": 1, \"b\": 2}",
+        "{\"a\": [1, 2}, \"a\": 3}", "{\"a\": 1, \"a\": [1, 2}", many_keys(""), many_keys("\"k42\": 0, "),
+        many_keys("\"k\\u0034\\u0032\": 0, "), many_keys("\"inner\": " + many_keys("\"k7\": 1, ") + ", "),
+    };
+    for (const std::string &text : documents)
+        if (open_error(text) != parse_error(text))
+            check(false, ("lazy document fails like the parser for " + text.substr(0, 60)).c_str());
+    check(!parse_error("{\"a\": 1, \"\\u0061\": 2}").empty(), "key escaped differently is still a duplicate");
+    check(parse_error(many_keys("")).empty() && !parse_error(many_keys("\"k42\": 0, ")).empty(), "duplicate among many keys is found");
+}
+
+void tests::json_lazy() {
+    get_matches_dom();
+    duplicate_keys();
+}
@@ -0,0 +1,257 @@
+#include "check.h"
+#include "../src/json/parser.h"
+#include "../src/json/parser_core.h"
+#include "../src/json/structural_index.h"
+
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <unistd.h>
+
+using namespace strtb;
+using namespace strtb::tests;
+
+// Output of parsing, or the error message, so results of different parsers can be compared
+static std::string parsed(const std::string &text) {
+    try {
+        json::value *val = json::parser::from_string(text);
+        std::string out = val->write_to_string();
+        delete val;
+        return out;
+    } catch (json::parser::invalid_json &e) {
+        return e.what();
+    }
+}
+
+static const char *document = "{\"name\": \"chat\", \"list\": [1, -2.5, true, false, null, \"\\u00e9\"], \"nested\": {\"a\": {}}}";
+
+// All entry points parse the same document the same way
+static void entry_points_agree() {
+    std::string expected = parsed(document);
+    check(expected.compare(0, 8, "invalid ") != 0, "test document is valid");
+
+    std::string text = document;
+    json::value *val = json::parser::from_buffer(text.data(), text.size());
+    check(val->write_to_string() == expected, "from_buffer() matches from_string()");
+    delete val;
+
+    std::istringstream stream(text);
+    val = json::parser::from_stream(stream);
+    check(val->write_to_string() == expected, "from_stream() matches from_string()");
+    delete val;
+
+    std::filesystem::path path = std::filesystem::temp_directory_path() / ("strtb-tests-json-" + std::to_string(getpid()));
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << text;
+    }
+    val = json::parser::from_file(path.c_str());
+    check(val->write_to_string() == expected, "from_file() of a mapped file matches from_string()");
+    delete val;
+    std::filesystem::remove(path);
+}
+
+// The buffer doesn't have to end with the document or be null-terminated
+static void buffer_is_bounded() {
+    std::string text = "[1, 2]garbage";
+    json::value *val = json::parser::from_buffer(text.data(), 6);
+    check(val->write_to_string() == "[1,2]", "only the given size was parsed");
+    delete val;
+    check(parsed("[1, 2]garbage").compare(0, 8, "invalid ") == 0, "trailing garbage is rejected");
+    check(parsed("").compare(0, 8, "invalid ") == 0, "empty document is rejected");
+}
+
+// Errors point at the line and column of the offending byte
+static void error_position() {
+    try {
+        delete json::parser::from_string("{\n  \"a\": 1,\n  \"b\" 2\n}");
+        check(false, "missing colon was rejected");
+    } catch (json::parser::invalid_json &e) {
+        check(std::string(e.what()) == "invalid JSON at line 3, col 7", "error is at the byte after the key");
+    }
+}
+
+// Token starts worked out byte by byte, to check the vectorized index against. Like the index, backslashes escape
+// quotes outside of strings too (where they're invalid anyway).
+static std::vector<uint32_t> naive_index(const std::string &text) {
+    std::vector<uint32_t> positions;
+    bool in_string = false, escaped = false, in_scalar = false;
+    for (size_t i=0; i<text.size(); i++) {
+        char c = text[i];
+        bool quote = c == '"' && !escaped;
+        escaped = !escaped && c == '\\';
+        if (in_string) {
+            in_string = !quote;
+            continue;
+        }
+        bool op = c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
+        if (quote || op) {
+            positions.push_back(i);
+            in_string = quote;
+            in_scalar = false;
+        } else if (json::parser::cursor::is_whitespace(c)) {
+            in_scalar = false;
+        } else if (!in_scalar) {
+            positions.push_back(i);
+            in_scalar = true;
+        }
+    }
+    positions.push_back(text.size());
+    return positions;
+}
+
+// Reads every token with a cursor, with or without an index, and lists what it found (or the error)
+static std::string tokens(const std::string &text, bool indexed) {
+    json::parser::structural_index index(text.data(), text.size());
+    json::parser::cursor in(text.data(), text.data() + text.size(), indexed ? index.get_positions() : nullptr);
+    std::string out;
+    try {
+        while (true) {
+            in.skip_whitespace();
+            int c = in.peek();
+            if (c == EOF)
+                break;
+            out += std::to_string(in.pos - in.begin) + ":";
+            if (c == '"') {
+                std::string str;
+                in.parse_string(str);
+                out += "\"" + str + "\"";
+            } else if (c == '-' || ('0' <= c && c <= '9')) {
+                json::parser::number num = in.parse_number();
+                out += num.is_fraction ? std::to_string(num.fraction) : std::to_string(num.integer);
+            } else if (c == 't' || c == 'f' || c == 'n') {
+                const char *word = c == 't' ? "true" : c == 'f' ? "false" : "null";
+                in.expect_word(word);
+                out += word;
+            } else {
+                out.push_back(c);
+                in.pos++;
+            }
+            out.push_back(' ');
+        }
+    } catch (json::parser::invalid_json &e) {
+        out += e.what();
+    }
+    return out;
+}
+
+// Strings with escapes right before the closing quote, and whitespace between them and the next token, which
+// is where the indexed fast path has to give up and leave it to the byte-by-byte scan
+static const char *fragments[] = {
+    "\"plain\"", "\"a\\\"b\"", "\"a\\\\\"", "\"\\\\\\\\\"", "\"\\\\\\\"\"", "\"a\\\"   \"", "\"x\\\" \\\"\"",
+    "\"\\u00e9\\ud83d\\ude00\"", "\"tab\\t\\n\"", "\"\"", "12.5e3", "-7", "true", "false", "null",
+    "\"bad \x01 control\"", "\"bad \\x escape\"", "\"unterminated \\\"",
+};
+
+// Documents are parsed the same with and without the structural index, wherever the 64-byte blocks split them
+static void indexed_matches_unindexed() {
+    for (const char *fragment : fragments) {
+        for (size_t padding=0; padding<70; padding++) {
+            for (const char *after : {"", " ", "\t\n  "}) {
+                std::string text = "[" + std::string(padding, ' ') + fragment + after + ", " + fragment + after + "]";
+                // The index ends with the size of the buffer, past the positions it counts
+                json::parser::structural_index index(text.data(), text.size());
+                std::vector<uint32_t> expected = naive_index(text);
+                if (index.size() + 1 != expected.size() || !std::equal(expected.begin(), expected.end(), index.get_positions())) {
+                    check(false, "index lists every token start");
+                    return;
+                }
+                if (tokens(text, true) != tokens(text, false)) {
+                    check(false, "indexed and unindexed cursors read the same tokens");
+                    return;
+                }
+            }
+        }
+    }
+}
+
+// Integers that don't fit in a long long are read as doubles, and out-of-range exponents saturate
+static void number_ranges() {
+    json::value *val = json::parser::from_string("[9223372036854775807, -9223372036854775808, 9223372036854775808, "
+                                                 "-9223372036854775809, 1e999, -1e999, 1e-999, -1e-999, 0.1, 2.0]");
+    const json::value_array &arr = *(json::value_array*) val;
+    check(arr.at(0).type() == json::VAL_INT && ((const json::value_int&) arr.at(0)).value() == std::numeric_limits<long long>::max(),
+          "largest integer stays an integer");
+    check(arr.at(1).type() == json::VAL_INT && ((const json::value_int&) arr.at(1)).value() == std::numeric_limits<long long>::min(),
+          "smallest integer stays an integer");
+    check(arr.at(2).type() == json::VAL_FLOAT && ((const json::value_float&) arr.at(2)).value() == 9223372036854775808.0,
+          "too big for an integer falls back to a double");
+    check(arr.at(3).type() == json::VAL_FLOAT && ((const json::value_float&) arr.at(3)).value() == -9223372036854775809.0,
+          "too small for an integer falls back to a double");
+    check(arr.at(4).type() == json::VAL_FLOAT && ((const json::value_float&) arr.at(4)).value() == std::numeric_limits<double>::max(),
+          "1e999 becomes the largest double");
+    check(arr.at(5).type() == json::VAL_FLOAT && ((const json::value_float&) arr.at(5)).value() == std::numeric_limits<double>::lowest(),
+          "-1e999 becomes the lowest double");
+    check(arr.at(6).type() == json::VAL_FLOAT && ((const json::value_float&) arr.at(6)).value() == 0, "1e-999 becomes 0");
+    check(arr.at(7).type() == json::VAL_FLOAT && ((const json::value_float&) arr.at(7)).value() == 0, "-1e-999 becomes 0");
+    check(arr.at(8).type() == json::VAL_FLOAT && ((const json::value_float&) arr.at(8)).value() == 0.1, "0.1 is read exactly");
+    check(arr.at(9).type() == json::VAL_FLOAT, "2.0 stays a float");
+    delete val;
+}
+
+// Doubles are written with enough digits to be read back as the same double, and stay floats
+static void number_round_trip() {
+    for (double num : {0.1, -2.5, 1.0 / 3, 1e300, -1e-300, 5e-324, 123456789012345678.0, 2.0, -0.0,
+                       std::numeric_limits<double>::max(), std::numeric_limits<double>::lowest()}) {
+        json::value_float original(num);
+        json::value *copy = json::parser::from_string(original.write_to_string());
+        check(copy->type() == json::VAL_FLOAT && ((json::value_float*) copy)->value() == num, "double survives writing and parsing");
+        delete copy;
+    }
+    check(parsed("[01]").compare(0, 8, "invalid ") == 0 && parsed("[1.]").compare(0, 8, "invalid ") == 0 &&
+          parsed("[.5]").compare(0, 8, "invalid ") == 0 && parsed("[1e]").compare(0, 8, "invalid ") == 0 &&
+          parsed("[-]").compare(0, 8, "invalid ") == 0 && parsed("[+1]").compare(0, 8, "invalid ") == 0,
+          "malformed numbers are rejected");
+}
+
+// Contents of a parsed string, or the error
+static std::string parsed_string(const std::string &text) {
+    try {
+        json::value *val = json::parser::from_string(text);
+        std::string out = val->type() == json::VAL_STRING ? ((json::value_string*) val)->value() : "not a string";
+        delete val;
+        return out;
+    } catch (json::parser::invalid_json &e) {
+        return e.what();
+    }
+}
+
+// Escaped surrogate pairs become one UTF-8 character, and unpaired halves become U+FFFD
+static void surrogates() {
+    check(parsed_string("\"\\ud83d\\ude00\"") == "\xf0\x9f\x98\x80", "surrogate pair");
+    check(parsed_string("\"\\uD83D\\uDE00\"") == "\xf0\x9f\x98\x80", "surrogate pair in upper case");
+    check(parsed_string("\"\\ud83d\"") == "\xef\xbf\xbd", "high surrogate at the end");
+    check(parsed_string("\"\\ude00\"") == "\xef\xbf\xbd", "low surrogate on its own");
+    check(parsed_string("\"\\ud83dx\"") == "\xef\xbf\xbdx", "high surrogate followed by a character");
+    check(parsed_string("\"\\ud83d\\u0041\"") == "\xef\xbf\xbd" "A", "high surrogate followed by another escape");
+    check(parsed_string("\"\\ud83d\\ud83d\\ude00\"") == "\xef\xbf\xbd\xf0\x9f\x98\x80", "two high surrogates, then a low one");
+    check(parsed_string("\"\\ude00\\ud83d\"") == "\xef\xbf\xbd\xef\xbf\xbd", "pair in the wrong order");
+    check(parsed_string("\"\\u00e9\\u20ac\"") == "\xc3\xa9\xe2\x82\xac", "two- and three-byte characters");
+    check(parsed_string("\"\\u0000\"") == std::string(1, '\0'), "escaped null character");
+    check(parsed_string("\"\\ud83d\\u12\"").compare(0, 8, "invalid ") == 0, "truncated second escape is rejected");
+}
+
+// Runs of plain characters are copied as they are, around escapes and up to the closing quote
+static void string_runs() {
+    std::string plain(100, 'x');
+    check(parsed_string("\"" + plain + "\"") == plain, "long plain string");
+    check(parsed_string("\"" + plain + "\\n" + plain + "\\\"\"") == plain + "\n" + plain + "\"", "escapes between long runs");
+    check(parsed_string("\"caf\xc3\xa9 \xf0\x9f\x98\x80\"") == "caf\xc3\xa9 \xf0\x9f\x98\x80", "UTF-8 is kept as it is");
+    check(parsed_string("\"" + plain + "\x1f\"").compare(0, 8, "invalid ") == 0, "control character after a long run is rejected");
+    check(parsed_string("\"tab\there\"").compare(0, 8, "invalid ") == 0, "raw tab is rejected");
+    check(parsed_string("\"" + plain).compare(0, 8, "invalid ") == 0, "unterminated string is rejected");
+}
+
+void tests::json_parser() {
+    entry_points_agree();
+    buffer_is_bounded();
+    error_position();
+    indexed_matches_unindexed();
+    number_ranges();
+    number_round_trip();
+    surrogates();
+    string_runs();
+}
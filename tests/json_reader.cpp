@@ -0,0 +1,127 @@
+#include "check.h"
+#include "../src/json/parser.h"
+#include "../src/json/reader.h"
+#include "../src/json/arena.h"
+
+#include <vector>
+
+using namespace strtb;
+using namespace strtb::tests;
+using json::parser::reader;
+
+// Output of parsing with a reader that isn't indexed, or the error message
+static std::string read_whole(const std::string &text) {
+    reader in(text.data(), text.size());
+    try {
+        json::value *val = json::parser::from_reader(in);
+        std::string out = val->write_to_string();
+        delete val;
+        if (in.next() != json::parser::TOKEN_END)
+            return "reader went on after the document";
+        return out;
+    } catch (json::parser::invalid_json &e) {
+        return e.what();
+    }
+}
+
+// Output of from_string(), which reads buffers with the structural index, or the error message
+static std::string parsed(const std::string &text) {
+    try {
+        json::value *val = json::parser::from_string(text);
+        std::string out = val->write_to_string();
+        delete val;
+        return out;
+    } catch (json::parser::invalid_json &e) {
+        return e.what();
+    }
+}
+
+// Tokens come one by one with their values, offsets and nesting depth
+static void token_sequence() {
+    std::string text = "{\"a\": [1, 2.5, \"x\\n\"], \"b\": {\"c\": null}, \"d\": true}";
+    reader in(text.data(), text.size());
+    std::string out;
+    for (json::parser::token tok = in.next(); tok != json::parser::TOKEN_END; tok = in.next()) {
+        out += std::to_string(in.token_offset()) + "/" + std::to_string(in.depth()) + ":";
+        switch (tok) {
+        case json::parser::TOKEN_NULL: out += "null"; break;
+        case json::parser::TOKEN_BOOL: out += in.bool_value() ? "true" : "false"; break;
+        case json::parser::TOKEN_INT: out += std::to_string(in.int_value()); break;
+        case json::parser::TOKEN_FLOAT: out += std::to_string(in.float_value()); break;
+        case json::parser::TOKEN_STRING: out += "\"" + in.string_value() + "\""; break;
+        case json::parser::TOKEN_KEY: out += in.string_value() + "="; break;
+        case json::parser::TOKEN_START_ARRAY: out += "["; break;
+        case json::parser::TOKEN_END_ARRAY: out += "]"; break;
+        case json::parser::TOKEN_START_OBJECT: out += "{"; break;
+        case json::parser::TOKEN_END_OBJECT: out += "}"; break;
+        default: break;
+        }
+        out += " ";
+    }
+    check(out == "0/1:{ 1/1:a= 6/2:[ 7/2:1 10/2:2.500000 15/2:\"x\n\" 20/1:] 23/1:b= 28/2:{ 29/2:c= 34/2:null 38/1:} "
+                 "41/1:d= 46/1:true 50/0:} ", "reader returned every token with its value, offset and depth");
+
+    // skip() jumps over the rest of the container that was just started
+    reader skipping(text.data(), text.size());
+    skipping.next();
+    skipping.next();
+    check(skipping.next() == json::parser::TOKEN_START_ARRAY, "reader is at the array");
+    skipping.skip();
+    check(skipping.depth() == 1 && skipping.next() == json::parser::TOKEN_KEY && skipping.string_value() == "b",
+          "skip() left the reader after the array");
+}
+
+// Parts of a document can be built one at a time, with the reader left right after each of them
+static void build_parts() {
+    std::string text = "[{\"a\": 1}, [2, {\"b\": []}], \"c\"]";
+    reader in(text.data(), text.size());
+    check(in.next() == json::parser::TOKEN_START_ARRAY, "reader started the outer array");
+    std::string parts;
+    for (int i=0; i<3; i++) {
+        json::value *val = json::parser::from_reader(in);
+        parts += val->write_to_string() + " ";
+        delete val;
+    }
+    check(parts == "{\"a\": 1} [2,{\"b\": []}] \"c\" ", "each item was built on its own");
+    check(in.next() == json::parser::TOKEN_END_ARRAY && in.depth() == 0, "reader was left before the closing bracket");
+    check(in.next() == json::parser::TOKEN_END, "document is over");
+}
+
+// Objects with many keys out of order, so the builder has to sort them, with and without a duplicate
+static std::string many_keys(bool duplicate) {
+    std::string text = "{";
+    for (int i=0; i<100; i++)
+        text += "\"k" + std::to_string((i * 37) % 100) + "\": " + std::to_string(i) + ", ";
+    if (duplicate)
+        text += "\"k42\": 0, ";
+    return text + "\"last\": [\"\\u00e9\", -0.5e2, false]}";
+}
+
+// Reading with and without the structural index builds the same values, and fails at the same place
+static void reader_matches_from_string() {
+    std::vector<std::string> documents = {
+        "null", " 12 ", "-0.25", "\"a\\\"b\\\\\"", "[]", "{}", "[[[]], {}]", "{\"a\": {\"b\": [1, {\"c\": \"d\"}]}}",
+        "{\"a\\u0000b\": 1, \"a\": 2}", many_keys(false), many_keys(true),
+        "{\"a\": 1, \"a\": 2}", "{\"a\": 1, \"b\": {\"a\": 2, \"a\": 3}}",
+        "", "[1, 2", "[1 2]", "{\"a\" 1}", "{\"a\": 1,}", "[1,]", "{1: 2}", "tru", "[nul]", "\"abc", "01", "1.",
+        "[1] [2]", "{\"a\": [1, 2}", "{\"a\": \"\\q\"}",
+    };
+    for (const std::string &text : documents) {
+        if (read_whole(text) != parsed(text))
+            check(false, ("reader without an index matches from_string() for " + text).c_str());
+    }
+
+    check(parsed(many_keys(true)).compare(0, 8, "invalid ") == 0, "duplicate key among many is rejected");
+
+    // Arena-built values are the same too
+    std::string text = many_keys(false);
+    json::arena arena;
+    json::value *val = json::parser::from_string(text, &arena);
+    check(val->write_to_string() == parsed(text), "arena document matches the heap one");
+}
+
+void tests::json_reader() {
+    token_sequence();
+    build_parts();
+    reader_matches_from_string();
+}
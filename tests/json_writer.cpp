@@ -0,0 +1,134 @@
+#include "check.h"
+#include "../src/json/parser.h"
+#include "../src/json/writer.h"
+#include "../src/json/all_value_types.h"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+using namespace strtb;
+using namespace strtb::tests;
+
+// Keys are sorted, since objects are written that way and the piece-by-piece output has to match
+static const char *document = "{\"list\": [0, -1, 9223372036854775807, 0.1, -2.0, 1e300, true, false, null, [], {}], "
+                              "\"nested\": {\"a\": {\"b\": [[\"c\"]]}}, "
+                              "\"text\": \"quote \\\" backslash \\\\ slash / tab \\t nul \\u0000 bell \\u0007 \\u00e9\\ud83d\\ude00\"}";
+
+// Written documents parse back to the same values, compact or pretty printed
+static void round_trip() {
+    json::value *val = json::parser::from_string(document);
+    std::string compact = val->write_to_string();
+    for (int pretty_print : {0, 2, 4}) {
+        json::value *copy = json::parser::from_string(val->write_to_string(pretty_print, "\r\n"));
+        check(copy->write_to_string() == compact, "written document was parsed back to the same values");
+        delete copy;
+    }
+    delete val;
+
+    // Every character that needs escaping is escaped, and comes back as it was
+    std::string all_bytes;
+    for (int c=1; c<128; c++)
+        all_bytes.push_back(c);
+    json::value_string str(all_bytes);
+    json::value *copy = json::parser::from_string(str.write_to_string());
+    check(((json::value_string*) copy)->value() == all_bytes, "string with every ASCII character was read back as it was");
+    delete copy;
+}
+
+// Pretty printing puts each item on its own line, but keeps empty containers together
+static void pretty_print() {
+    json::value *val = json::parser::from_string("{\"a\": [1, 2.5, \"x\"], \"b\": {}, \"c\": []}");
+    check(val->write_to_string(2) == "{\n  \"a\": [\n    1,\n    2.5,\n    \"x\"\n  ],\n  \"b\": {},\n  \"c\": []\n}",
+          "pretty printed document is indented");
+    check(val->write_to_string() == "{\"a\": [1,2.5,\"x\"],\"b\": {},\"c\": []}", "compact document has no line breaks");
+    delete val;
+}
+
+// Writing piece by piece gives the same output as writing the whole value, also when the buffer is flushed midway
+static void streaming_matches_values() {
+    json::value *val = json::parser::from_string(document);
+    std::string expected = val->write_to_string(2);
+    delete val;
+
+    std::string out;
+    {
+        json::writer w(out, 2);
+        w.start_object();
+        w.key("list");
+        w.start_array();
+        w.integer(0);
+        w.integer(-1);
+        w.integer(std::numeric_limits<long long>::max());
+        w.fraction(0.1);
+        w.fraction(-2.0);
+        w.fraction(1e300);
+        w.boolean(true);
+        w.boolean(false);
+        w.null();
+        w.start_array();
+        w.end_array();
+        w.start_object();
+        w.end_object();
+        w.end_array();
+        w.key("nested");
+        w.start_object();
+        w.key("a");
+        w.start_object();
+        w.key("b");
+        w.start_array();
+        w.start_array();
+        w.string("c");
+        w.end_array();
+        w.end_array();
+        w.end_object();
+        w.end_object();
+        w.key("text");
+        w.string("quote \" backslash \\ slash / tab \t nul " + std::string(1, '\0') + " bell \x07 \xc3\xa9\xf0\x9f\x98\x80");
+        w.end_object();
+    }
+    check(out == expected, "document written piece by piece matches the value written at once");
+
+    // Enough to be flushed to the stream several times
+    json::value_array arr;
+    for (int i=0; i<50000; i++)
+        arr.push_back_move(new json::value_string("item " + std::to_string(i)));
+    std::ostringstream stream;
+    {
+        json::writer w(stream);
+        w.write(arr);
+    }
+    check(stream.str() == arr.write_to_string(), "stream got all of the output once the writer was gone");
+}
+
+// JSON has no infinities or NaN, so they're written as the largest doubles and null, which can be read back
+static void non_finite_numbers() {
+    std::string out;
+    {
+        json::writer w(out);
+        w.start_array();
+        w.fraction(std::numeric_limits<double>::infinity());
+        w.fraction(-std::numeric_limits<double>::infinity());
+        w.fraction(std::nan(""));
+        w.fraction(-std::nan(""));
+        w.end_array();
+    }
+    json::value *val = json::parser::from_string(out);
+    const json::value_array &arr = *(json::value_array*) val;
+    check(arr.size() == 4, "all numbers were written");
+    check(arr.at(0).type() == json::VAL_FLOAT && ((const json::value_float&) arr.at(0)).value() == std::numeric_limits<double>::max(),
+          "infinity was written as the largest double");
+    check(arr.at(1).type() == json::VAL_FLOAT && ((const json::value_float&) arr.at(1)).value() == std::numeric_limits<double>::lowest(),
+          "-infinity was written as the lowest double");
+    check(arr.at(2).type() == json::VAL_NULL && arr.at(3).type() == json::VAL_NULL, "NaN was written as null");
+    delete val;
+
+    check(json::value_float(std::nan("")).write_to_string() == "null", "NaN value was written as null");
+}
+
+void tests::json_writer() {
+    round_trip();
+    pretty_print();
+    streaming_matches_values();
+    non_finite_numbers();
+}
@@ -0,0 +1,24 @@
+#include "check.h"
+
+using namespace strtb;
+
+int tests::failures = 0;
+
+int main() {
+    tests::chat_merger();
+    tests::chat_queue();
+    tests::chat_routing();
+    tests::chat_snapshot();
+    tests::json_arena();
+    tests::json_incremental();
+    tests::json_lazy();
+    tests::json_parser();
+    tests::json_reader();
+    tests::json_writer();
+    if (tests::failures) {
+        fprintf(stderr, "%d checks failed\n", tests::failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
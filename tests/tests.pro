@@ -0,0 +1,25 @@
+QT       -= gui
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = strtb-tests
+LIBS += -L../libstrtb -lstrtb
+
+include( ../version.pri )
+
+SOURCES += \
+    chat_merger.cpp \
+    chat_queue.cpp \
+    chat_routing.cpp \
+    chat_snapshot.cpp \
+    json_arena.cpp \
+    json_incremental.cpp \
+    json_lazy.cpp \
+    json_parser.cpp \
+    json_reader.cpp \
+    json_writer.cpp \
+    main.cpp \
+
+HEADERS += \
+    check.h \